@@ -14,7 +14,7 @@
 
 #include <iostream> 
 #include <vector>   // For dynamic array
-#include <queue>    // For FIFO queue
+#include <queue>    // For FIFO queue and the scheduler's blocked queue
 #include <cstdlib> // For rand() and srand()
 #include <ctime>  
 #include <unordered_map> // for hash map
@@ -25,6 +25,16 @@
 #include <algorithm> // For count_if
 #include <thread>   // For sleep in simulate
 #include <chrono>   // For sleep in simulate
+#include <cstdint>  // For fixed width integers in the trace format
+#include <deque>    // For the decoded trace block buffer
+#include <mutex>    // For the trace decoder thread
+#include <condition_variable> // For the trace decoder thread
+#include <map>      // For per-size Zipf tables in the workload generator
+#include <cmath>    // For pow in Zipf weights
+#include <climits>  // For INT_MAX
+#include <csignal>  // For the SIGUSR1 stats dump
+#include <numeric>  // For iota when prepaging a job's first pages, gcd
+#include <stdexcept> // For the errors stoi and stod throw on bad input
 using namespace std;
 
 
@@ -36,6 +46,14 @@ using namespace std;
     - its size
     - we want to track how many pages are loaded
     - track page faults
+    - a list of the frames it holds, so its memory can be released
+      in O(resident pages) when it terminates
+    - a frame quota and priority for local replacement
+    - when it last faulted, for the page-fault-frequency controller
+    - its working set W(t, delta) when working sets are tracked
+    - whether the load controller has swapped it out
+    - its prefetcher state
+    - whether it has started, and the working set saved when it was swapped out
 */
 
 struct Job {
@@ -47,6 +65,43 @@ struct Job {
     unordered_set<int> loadedPages; // Track which pages are currently in memory
     unordered_map<int, int> pageTable; // Page number to Frame number mapping
     int pageFaults; // Count of page faults for this job
+    int minorFaults = 0; // faults on never-written pages, served without a swap read (zero page)
+    int residentHead = -1; // Newest frame of this job's resident list (-1 if none)
+    int residentTail = -1; // Oldest frame, the local FIFO victim
+    int residentCount = 0; // Frames currently held
+    int frameQuota = 0; // Most frames the job may hold under local replacement (0 = no limit)
+    int priority = 1; // Weight for priority quotas
+    long long references = 0; // References made by this job
+    long long residentSum = 0; // residentCount summed over its references, for the average
+    long long lastFaultReference = 0; // PFF: job's reference count at its previous fault
+    int lastFaultTime = 0; // PFF: currentTime at its previous fault
+
+    // Working set: the last workingSetWindow pages referenced, kept as a ring,
+    // with a count of each page's references inside the window
+    vector<int> window;
+    int windowPos = 0;
+    vector<int> windowCount; // indexed by page number
+    int workingSetSize = 0; // distinct pages in the window
+    long long workingSetSum = 0; // summed over its references, for the average
+    int workingSetMax = 0;
+
+    bool suspended = false; // swapped out by the load controller
+    deque<pair<int, bool>> deferredReferences; // (address, write) made while suspended, replayed on resume
+
+    int lastFaultPage = -2; // prefetch: page of its previous fault (or prefetch hit, for stride/markov)
+    int readaheadEnd = -1; // one past the last page read ahead (-1 if none)
+    int readaheadWindow = 0; // pages to prefetch on the next predicted fault
+    int lastStride = 0; // stride prefetcher: last distance between faults
+    int strideConfidence = 0; // times in a row lastStride repeated (saturates at 3)
+
+    bool started = false; // has referenced a page since it (re)started
+    bool restorePending = false; // resumed; its saved working set comes back on its next reference
+    vector<int> savedWorkingSet; // pages it was using when the load controller swapped it out
+    int startupReferences = 0; // references left in its startup window
+
+    int parentID = 0; // job it was forked from (0 = not a fork)
+    int sharedPages = 0; // pages it maps from frames another job owns
+    vector<bool> written; // dedup content model: pages whose contents are its own (empty = not tracked)
 };
 
 /*
@@ -58,6 +113,7 @@ struct Job {
     - the job ID it is currently holding
     - access time for LRU replacement
     - modified and referenced bits
+    - links for the replacement order list and its owner's resident list
 */
 struct PageFrame {
     int frameID;
@@ -66,6 +122,17 @@ struct PageFrame {
     int jobID; // Job currently holding this frame
     int pageNumber; // Page number currently in this frame
     int accessTime; // For LRU replacement algorithm
+    int prevFrame; // Replacement order list (oldest -> newest), -1 at the ends
+    int nextFrame;
+    int jobPrevFrame; // Owner job's resident list, -1 at the ends
+    int jobNextFrame;
+    bool modified; // Dirty: written since it was loaded, must be written back on eviction
+    bool referenced; // Used since the last NRU reset
+    bool prefetched; // Read ahead and not referenced yet
+    bool prepaged; // Loaded by prepaging on admission or resume, not referenced yet
+    uint64_t readyTime; // When a background prefetch read completes (0 = present)
+    int hugeHead; // First frame of the huge page this frame belongs to (-1 = base page)
+    int mapCount; // Page table entries pointing at this frame (0 = free, above 1 = shared copy-on-write)
 };
 
 // Global memory frames
@@ -74,7 +141,553 @@ vector<PageFrame> memoryFrames;
 
 // Global variables for demand paging
 int currentTime = 0; // Global time counter for LRU
-queue<int> fifoQueue; // For FIFO replacement
+
+// Replacement order: a doubly linked list threaded through the frames
+// (head = oldest page, the FIFO victim). Unlike a queue, any frame can be
+// removed in O(1), which job termination needs.
+int replacementHead = -1;
+int replacementTail = -1;
+
+/*
+    REPLACEMENT SCOPE
+    - Global: any job's page can be evicted for any fault (one FIFO order for all frames)
+    - Local : each job has a frame quota and, once at its quota, evicts its own
+              oldest page. A job under quota takes a free frame; if memory is
+              full anyway (quotas over-committed) it still evicts its own page
+              when it has one, so other jobs stay isolated.
+    - PFF   : local replacement where the page-fault frequency moves the quota.
+              At each fault the controller measures the job's inter-fault time
+              (its own references since its previous fault):
+                fault rate above pffUpperRate -> quota grows by one frame, if a
+                                                 free frame is there to back it
+                fault rate below pffLowerRate -> pages the job has not used since
+                                                 its previous fault are released
+                                                 and the quota shrinks to fit
+    - WS    : working-set replacement. A page is released as soon as it leaves its
+              job's window of the last workingSetWindow references, so each job
+              holds exactly its working set; a fault takes a free frame or, if
+              memory is over-committed, the oldest page in the global order.
+    Quotas split the frames equally, in proportion to jobSize, or in
+    proportion to priority (for PFF this is only the starting point).
+*/
+enum ReplacementScope { GLOBAL_REPLACEMENT, LOCAL_REPLACEMENT, PFF_REPLACEMENT, WORKING_SET_REPLACEMENT };
+const char *SCOPE_NAMES[] = {"global", "local", "pff", "ws"};
+enum QuotaPolicy { QUOTA_EQUAL, QUOTA_PROPORTIONAL, QUOTA_PRIORITY };
+const char *QUOTA_POLICY_NAMES[] = {"equal", "proportional", "priority"};
+
+ReplacementScope replacementScope = GLOBAL_REPLACEMENT;
+
+/*
+    REPLACEMENT POLICY (global victims)
+    - fifo : oldest page
+    - nru  : Not Recently Used, the oldest page of the lowest class
+               0 = not referenced, clean      1 = not referenced, modified
+               2 = referenced, clean          3 = referenced, modified
+             Referenced bits are cleared every nruResetInterval references.
+    - clean: oldest clean page, so evictions avoid a write-back when they can
+    nru and clean walk the FIFO order until they find a best-class page,
+    so a victim can cost O(frames) when every page is in a worse class.
+    Local replacement always takes the job's own oldest page.
+*/
+enum ReplacementPolicy { POLICY_FIFO, POLICY_NRU, POLICY_CLEAN_FIRST };
+const char *POLICY_NAMES[] = {"fifo", "nru", "clean"};
+
+ReplacementPolicy replacementPolicy = POLICY_FIFO;
+int nruResetInterval = 10000;
+int referencesSinceReset = 0;
+
+/*
+    PREFETCHERS
+    One prefetcher runs at a time; each loads up to a job's readaheadWindow
+    pages it predicts will be referenced soon:
+    - readahead : a fault on the page after the job's previous fault, or on the
+                  first page past its last read-ahead, reads the next pages in
+                  the same I/O as the faulting page (consecutive swap slots)
+    - stride    : a per-job detector that prefetches page + k * stride once the
+                  same stride has been seen three times in a row
+    - markov    : a direct-mapped table of page -> two most frequent successors,
+                  followed as a chain from the faulting page
+    Stride and Markov train on faults and prefetch hits (so a prefetcher that is
+    working keeps seeing the pattern), and their pages are scattered, so each is
+    its own background read. The window adapts per job:
+    - a prefetched page that gets referenced (a prefetch hit) grows it by one
+    - one evicted or dropped without being referenced (wasted) halves it
+    bounded by readaheadMin and readaheadMax.
+*/
+enum PrefetcherKind { PREFETCH_NONE, PREFETCH_READAHEAD, PREFETCH_STRIDE, PREFETCH_MARKOV };
+const char *PREFETCHER_NAMES[] = {"none", "readahead", "stride", "markov"};
+PrefetcherKind prefetcher = PREFETCH_NONE;
+int readaheadMin = 2;
+int readaheadMax = 64;
+int pendingReadahead = 0; // pages read ahead by the current fault, not yet handed to the swap device
+vector<int> pendingPrefetchFrames; // stride/Markov pages not yet handed to the swap device
+int prefetchHitFrame = -1; // prefetched frame the current reference hit (it may still be in flight)
+int pinnedFrame = -1; // frame of the page being referenced while the prefetcher runs: never a victim
+
+// Markov table entry: a page's two most frequent successors, tagged by job and page
+struct MarkovEntry {
+    int jobID = -1;
+    int page = -1;
+    int next[2] = {-1, -1};
+    uint16_t count[2] = {0, 0};
+};
+vector<MarkovEntry> markovTable;
+
+/*
+    PREPAGING
+    Instead of faulting a starting job in one page at a time:
+    - on admission (its first reference since it started) load its first
+      prepagePages pages
+    - on resume after the load controller swapped it out, load the working
+      set it had when it was suspended (restoreOnResume)
+    Either way the pages come in as one batched read that the job's
+    reference waits for. Faults in the first startupWindow references after
+    an admission or resume are counted as startup faults, with or without
+    prepaging, so runs can be compared.
+*/
+int prepagePages = 0;
+bool restoreOnResume = false;
+int startupWindow = 1000;
+int pendingPrepage = 0; // prepaged pages not yet handed to the swap device
+
+// Dirty pages evicted but not yet handed to the swap device
+int pendingWriteBacks = 0;
+int dirtyFrames = 0; // frames with the modified bit set
+double pffUpperRate = 0.05; // faults per reference
+double pffLowerRate = 0.005;
+
+// Working set tracking (off when the window is 0). The window delta is
+// counted in the job's own references (its virtual time).
+int workingSetWindow = 0;
+uint64_t workingSetSampleInterval = 100000; // references between time series samples
+
+struct WorkingSetSample {
+    uint64_t time; // references replayed so far
+    vector<int> sizes; // one per job, in job table order
+};
+vector<WorkingSetSample> workingSetSeries;
+
+// Free frames: a stack of frame indexes plus each free frame's slot in it,
+// so taking the next free frame, or a specific one, is O(1)
+vector<int> freeFrames;
+vector<int> freeSlot; // -1 if the frame is in use
+
+/*
+    BUDDY ALLOCATOR
+    The same free frames, also kept as power-of-two blocks aligned to their
+    size, with a free list per order (a block of order k is 2^k frames).
+    - freeing a frame merges it with its buddy while the buddy is free too
+    - taking a specific frame splits the free block holding it down to one frame
+    - single frames come from the smallest free block, keeping large blocks whole
+    Each is O(log n). Memory that is not a power of two starts as the largest
+    aligned blocks that fit. blockOrder[f] is the order of the free block that
+    starts at frame f (-1 if none), blockSlot[f] its position in that order's list.
+*/
+vector<vector<int>> buddyFreeLists;
+vector<int> blockOrder;
+vector<int> blockSlot;
+uint32_t buddyOrderMask = 0; // bit k set when order k has a free block
+
+/*
+    HUGE PAGES
+    With huge pages on, a job's pages are grouped into aligned regions of
+    `frames` pages. A fault in a full region of a large enough job maps the
+    whole region at once onto an aligned block of `frames` contiguous base
+    frames: one huge page, one page table entry, one TLB entry. The tail of
+    a job that does not fill a region stays in base pages, so a job can mix
+    both sizes. The block comes from the buddy allocator. If none is free,
+    global replacement reclaims the whole block around the policy's victim
+    (lumpy reclaim); otherwise the fault falls back to a base page. Evicting
+    or releasing any frame of a huge page splits it back into base pages
+    first.
+*/
+struct HugePageState {
+    int frames = 0; // base pages per huge page (0 = huge pages off)
+    int minPages = 0; // only jobs at least this large get huge pages
+    int order = 0; // log2(frames): the buddy order of a huge page
+    int mapped = 0; // huge pages currently mapped
+    uint64_t allocations = 0;
+    uint64_t fallbacks = 0; // eligible faults that got a base page instead
+    uint64_t fragmentedFailures = 0; // no free block although enough frames were free
+    uint64_t lumpyReclaims = 0; // blocks emptied to make a huge page
+    uint64_t splits = 0;
+};
+HugePageState hugePages;
+int pendingHugeRead = 0; // rest-of-region pages not yet handed to the swap device
+
+/*
+    COMPACTION AND PROMOTION
+    Compaction migrates pages to free up an aligned block when enough frames
+    are free but none of the blocks is: it picks the block with the most free
+    frames (and no huge page in it) and moves each of its pages to a free frame
+    outside it. A migrated page keeps its place in the replacement order and
+    in its job's resident list, and its page table entry is updated. Direct
+    compaction runs on a huge page fault before lumpy reclaim, and the fault
+    waits for the copies (migrateCost time units per page).
+
+    The promoter (khugepaged) wakes every `interval` references and scans up to
+    `scanRegions` huge-page regions, round robin over the jobs. A region whose
+    pages are all resident as base pages is collapsed: its pages are copied
+    into a free (or compacted) aligned block and mapped as one huge page.
+    Its copies run in the background, so their cost is reported, not charged.
+*/
+struct Compaction {
+    bool enabled = false;
+    int migrateCost = 10; // time units to copy one page
+    uint64_t runs = 0;
+    uint64_t failures = 0; // no block could be freed by migration
+    uint64_t migrations = 0; // pages moved (by compaction or collapses)
+};
+Compaction compaction;
+uint64_t pendingMigrationTime = 0; // page copies (direct compaction, copy-on-write) the current reference waits for
+
+struct Promoter {
+    bool enabled = false;
+    int interval = 10000; // references between wake-ups
+    int scanRegions = 64; // regions checked per wake-up
+    int sinceWake = 0;
+    size_t jobCursor = 0;
+    int regionCursor = 0;
+    uint64_t wakeups = 0;
+    uint64_t regionsScanned = 0;
+    uint64_t collapses = 0;
+    uint64_t failures = 0; // collapsible regions with no block for them, or a page that would not move
+};
+Promoter promoter;
+
+/*
+    TLB
+    A set-associative TLB (4 ways, LRU within a set) over translations:
+    one entry covers a base page or a whole huge page, so huge pages
+    multiply its reach. Entries are invalidated when a page is unmapped.
+*/
+struct TLB {
+    int sets = 0; // 0 = no TLB model
+    int ways = 4;
+    vector<uint64_t> keys;
+    vector<uint64_t> lastUse;
+    uint64_t clock = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+TLB tlb;
+double tlbMissCost = 0.5; // time units per page walk, for weighing TLB misses against migrations
+const uint64_t TLB_EMPTY = UINT64_MAX;
+const uint64_t TLB_HUGE_BIT = 0x80000000ULL;
+
+/*
+    SHARED PAGES AND COPY-ON-WRITE
+    A frame can be mapped by several jobs at once. Its owner (frame.jobID,
+    frame.pageNumber) holds it on its resident list and is charged for it;
+    every other mapping is a (jobID, page) entry in `mappers`, and mapCount
+    counts them all. Forking a job shares each of its resident pages with the
+    child by copying page table entries only, so a fork costs O(pages), not
+    O(bytes). A write to a shared page is a copy-on-write fault: the writer
+    drops its mapping and gets a private copy (migrateCost time units).
+    - a job that exits, is suspended or releases a shared page drops only its
+      own mapping; if it owned the frame, another mapper takes it over
+      (one with room under its local quota, if there is one)
+    - evicting a shared frame unmaps it from every job that mapped it
+    Shared frames are never migrated or part of a huge page.
+*/
+struct SharedMemory {
+    unordered_map<int, vector<pair<int, int>>> mappers; // frame -> (jobID, page) of its non-owner mappings
+    vector<Job> *jobs = nullptr; // job table the mappers' IDs refer to
+    int extraMappings = 0; // sum of mapCount - 1 over shared frames: frames saved right now
+    uint64_t forks = 0;
+    uint64_t pagesShared = 0; // page table entries copied by forks
+    uint64_t cowFaults = 0;
+    uint64_t handovers = 0; // shared frames passed to another mapper when the owner let go
+    uint64_t unmappedByEviction = 0; // mappings dropped because their shared frame was evicted
+};
+SharedMemory sharing;
+
+/*
+    SAME-PAGE MERGING (KSM)
+    Traces carry no page contents, so contents come from a model: a page a
+    job has never written holds its program image, the same for a job and
+    its forks; once written, it is the job's own. A background scanner wakes
+    every `interval` references and hashes the next `pagesToScan` pages in
+    frame order. The stable tree maps a content hash to a frame holding it;
+    a page whose contents are already in another frame is merged into it:
+    its mappings move there as copy-on-write mappings and its frame is freed.
+    Pages that are written, prefetched and not yet used, or part of a huge
+    page are skipped, like the pages KSM finds volatile. Hashing costs
+    scanCost time units per page; the scanner runs in the background, so
+    its cost is reported against the frames it reclaimed, not charged.
+*/
+struct SamePageMerging {
+    bool enabled = false;
+    int interval = 1000; // references between wake-ups
+    int pagesToScan = 100; // pages hashed per wake-up
+    int scanCost = 2; // time units to hash one page
+    int sinceWake = 0;
+    int cursor = 0; // next frame to scan
+    unordered_map<uint64_t, int> stableTree; // content hash -> frame holding it
+    uint64_t wakeups = 0;
+    uint64_t pagesScanned = 0;
+    uint64_t fullScans = 0; // passes over all of memory
+    uint64_t merges = 0; // frames freed by merging
+};
+SamePageMerging ksm;
+
+/*
+    ZERO PAGE
+    A page no job has written holds nothing but zeros, so a fault on it is a
+    minor fault with no swap read. A read maps the one shared zero frame,
+    reserved at the end of memory, read-only. A write, or the first write to
+    a page on the zero frame (a copy-on-write fault), gives the job a
+    zero-filled frame of its own. Minor faults count towards the fault rates
+    that drive PFF and load control, but not as page faults.
+    Pages a job has written (tracked as for KSM) fault in from swap as usual.
+    The zero frame is never evicted, migrated or part of a huge page; its
+    mapCount is one more than the pages mapping it, so every mapping of it
+    counts as shared.
+*/
+struct ZeroPage {
+    int frame = -1; // the zero frame (-1 = zero page off)
+    uint64_t faults = 0; // read faults served by mapping the zero frame
+    uint64_t firstWrites = 0; // first writes to never-written pages, given a zero-filled frame
+};
+ZeroPage zeroPage;
+
+// Job index: jobIndex[jobID] = position of that job in the jobs vector (-1 if none)
+// Dense, so finding a frame's owner is one array read instead of a scan
+const int MAX_JOB_ID = 1 << 24;
+vector<int> jobIndex;
+
+/*
+    HOT PATH INSTRUMENTATION
+    Counters and histograms updated inside the fault path.
+    Build with -DNO_PAGING_STATS to compile every STAT_* use out
+    (the macros expand to nothing, so the hot path is untouched).
+
+    LogHistogram is HDR-style: exact below 64, then 32 linear
+    sub-buckets per power of two (about 3% relative error) up to 2^64.
+*/
+const int HISTOGRAM_SUB_BITS = 5;
+const int HISTOGRAM_SUB_COUNT = 1 << HISTOGRAM_SUB_BITS;
+// Two exact groups below 64, then one group per power of two from 2^6 to 2^63
+const int HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT;
+
+struct LogHistogram {
+    uint64_t counts[HISTOGRAM_BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+};
+
+inline int histogramBucket(uint64_t value) {
+    if (value < 2 * HISTOGRAM_SUB_COUNT) {
+        return (int)value;
+    }
+    int shift = (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BITS;
+    return shift * HISTOGRAM_SUB_COUNT + (int)(value >> shift);
+}
+
+// Smallest value that lands in a bucket
+uint64_t histogramBucketValue(int bucket) {
+    if (bucket < 2 * HISTOGRAM_SUB_COUNT) {
+        return bucket;
+    }
+    int shift = bucket / HISTOGRAM_SUB_COUNT - 1;
+    return (uint64_t)(bucket % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT) << shift;
+}
+
+inline void recordValue(LogHistogram &histogram, uint64_t value) {
+    histogram.counts[histogramBucket(value)]++;
+    histogram.total++;
+    histogram.maxValue = max(histogram.maxValue, value);
+}
+
+uint64_t histogramPercentile(const LogHistogram &histogram, double percentile) {
+    uint64_t target = (uint64_t)(histogram.total * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += histogram.counts[b];
+        if (seen > target) {
+            return min(histogramBucketValue(b), histogram.maxValue);
+        }
+    }
+    return histogram.maxValue;
+}
+
+struct PagingStats {
+    uint64_t references = 0;
+    uint64_t hits = 0;
+    uint64_t faults = 0;
+    uint64_t minorFaults = 0; // zero page: faults on never-written pages, no swap read
+    uint64_t evictions = 0;
+    uint64_t pageTableProbes = 0; // lookups in a job's loadedPages / pageTable
+    uint64_t freeFrameScans = 0;
+    uint64_t victimLookupIterations = 0; // job index reads to find an evicted page's owner
+    uint64_t terminations = 0;
+    uint64_t framesReclaimed = 0; // frames released by terminating jobs
+    uint64_t quotaGrows = 0; // PFF controller decisions
+    uint64_t quotaShrinks = 0;
+    uint64_t pffReleased = 0; // pages dropped by PFF shrinks
+    uint64_t workingSetReleases = 0; // pages released on leaving the working set
+    uint64_t writeReferences = 0;
+    uint64_t writeBacks = 0; // dirty pages evicted
+    uint64_t victimScanFrames = 0; // frames examined by nru/clean victim selection
+    uint64_t directReclaims = 0; // faults that found no free frame and evicted inline
+    uint64_t reclaimWakeups = 0;
+    uint64_t reclaimedPages = 0; // evicted by the background reclaimer
+    uint64_t prefetchedPages = 0; // read ahead
+    uint64_t prefetchHits = 0; // read-ahead pages later referenced (faults avoided)
+    uint64_t prefetchWasted = 0; // read-ahead pages released unreferenced
+    uint64_t latePrefetchHits = 0; // prefetch hits that found the read still in flight
+    uint64_t prefetchStallTime = 0; // time late prefetch hits waited
+    uint64_t admissions = 0; // first references of a started or restarted job
+    uint64_t resumes = 0; // first references after the load controller resumed a job
+    uint64_t startupFaults = 0; // faults in the startup window after those
+    uint64_t prepagedPages = 0;
+    uint64_t prepageHits = 0; // prepaged pages later referenced (faults avoided)
+    uint64_t prepageWasted = 0; // prepaged pages released unreferenced
+    LogHistogram referenceLatency; // ns per reference
+    LogHistogram faultLatency; // virtual time units from a fault to its page being ready
+};
+
+PagingStats pagingStats;
+
+#ifndef NO_PAGING_STATS
+#define STAT_ADD(counter, n) (pagingStats.counter += (n))
+#define STAT_RECORD(histogram, value) recordValue(pagingStats.histogram, (value))
+#else
+#define STAT_ADD(counter, n) ((void)0)
+#define STAT_RECORD(histogram, value) ((void)0)
+#endif
+#define STAT_INC(counter) STAT_ADD(counter, 1)
+
+void resetPagingStats() {
+    pagingStats = PagingStats();
+}
+
+void printHistogram(const string &title, const LogHistogram &histogram, const string &unit) {
+    cout << title << " (" << histogram.total << " samples, " << unit << ")\n";
+    if (histogram.total == 0) {
+        return;
+    }
+    const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+    const char *labels[] = {"p50", "p90", "p99", "p99.9"};
+    for (int i = 0; i < 4; i++) {
+        cout << "  " << left << setw(7) << labels[i] << ": " << histogramPercentile(histogram, percentiles[i]) << "\n";
+    }
+    cout << "  max    : " << histogram.maxValue << "\n";
+}
+
+// Function: printPagingStats
+// Purpose: Dumps the hot path counters and histograms
+void printPagingStats() {
+#ifdef NO_PAGING_STATS
+    cout << "\n(paging stats compiled out with NO_PAGING_STATS)\n";
+#else
+    const PagingStats &s = pagingStats;
+    cout << "\n--- Paging Stats ---\n";
+    cout << "References            : " << s.references << "\n";
+    cout << "Hits                  : " << s.hits << "\n";
+    cout << "Faults                : " << s.faults << "\n";
+    if (s.minorFaults > 0) {
+        cout << "Minor Faults          : " << s.minorFaults << "\n";
+    }
+    cout << "Evictions             : " << s.evictions << "\n";
+    cout << "Page Table Probes     : " << s.pageTableProbes << "\n";
+    cout << "Free Frame Lookups    : " << s.freeFrameScans << "\n";
+    cout << "Victim Lookup Iters   : " << s.victimLookupIterations << "\n";
+    cout << "Terminations          : " << s.terminations << " (" << s.framesReclaimed << " frames reclaimed)\n";
+    if (s.quotaGrows + s.quotaShrinks > 0) {
+        cout << "PFF Quota Changes     : " << s.quotaGrows << " grows, " << s.quotaShrinks << " shrinks ("
+             << s.pffReleased << " pages released)\n";
+    }
+    cout << "Write References      : " << s.writeReferences << "\n";
+    cout << "Write-backs           : " << s.writeBacks;
+    if (s.evictions > 0) {
+        cout << " (" << fixed << setprecision(1) << 100.0 * s.writeBacks / s.evictions << "% of evictions dirty)";
+    }
+    cout << "\n";
+    cout << "Direct Reclaims       : " << s.directReclaims;
+    if (s.faults > 0) {
+        cout << " (" << fixed << setprecision(1) << 100.0 * s.directReclaims / s.faults << "% of faults)";
+    }
+    cout << "\n";
+    if (s.reclaimWakeups > 0) {
+        cout << "Background Reclaim    : " << s.reclaimWakeups << " wake-ups, " << s.reclaimedPages << " pages\n";
+    }
+    if (s.prefetchedPages > 0) {
+        cout << "Prefetched            : " << s.prefetchedPages << " pages, " << s.prefetchHits << " hits, "
+             << s.prefetchWasted << " wasted\n";
+        cout << "  accuracy            : " << fixed << setprecision(1) << 100.0 * s.prefetchHits / s.prefetchedPages
+             << "% of prefetched pages used\n";
+        cout << "  coverage            : " << 100.0 * s.prefetchHits / max<uint64_t>(s.prefetchHits + s.faults, 1)
+             << "% of would-be faults avoided\n";
+        cout << "  timeliness          : " << 100.0 * (s.prefetchHits - s.latePrefetchHits) / max<uint64_t>(s.prefetchHits, 1)
+             << "% of hits ready in time";
+        if (s.latePrefetchHits > 0) {
+            cout << " (late hits waited " << (double)s.prefetchStallTime / s.latePrefetchHits << " on average)";
+        }
+        cout << "\n";
+    }
+    if (s.admissions + s.resumes > 0) {
+        cout << "Startup Faults        : " << s.startupFaults << " in the first " << startupWindow << " references after "
+             << s.admissions << " admissions and " << s.resumes << " resumes\n";
+    }
+    if (s.prepagedPages > 0) {
+        cout << "Prepaged              : " << s.prepagedPages << " pages, " << s.prepageHits << " hits, "
+             << s.prepageWasted << " wasted (" << fixed << setprecision(1) << 100.0 * s.prepageHits / s.prepagedPages
+             << "% used)\n";
+    }
+    if (s.victimScanFrames > 0) {
+        cout << "Victim Scan Frames    : " << s.victimScanFrames << "\n";
+    }
+    if (s.workingSetReleases > 0) {
+        cout << "Working Set Releases  : " << s.workingSetReleases << "\n";
+    }
+    printHistogram("Reference Latency", s.referenceLatency, "ns");
+    printHistogram("Fault Latency", s.faultLatency, "time units");
+#endif
+    cout << flush;
+}
+
+// Set from the SIGUSR1 handler, the replay loops print the stats when they see it
+volatile sig_atomic_t statsDumpRequested = 0;
+
+void onStatsSignal(int) {
+    statsDumpRequested = 1;
+}
+
+void checkStatsDump() {
+    if (statsDumpRequested) {
+        statsDumpRequested = 0;
+        printPagingStats();
+    }
+}
+
+// Function: buildJobIndex
+// Purpose: Rebuilds the jobID -> position index for a jobs vector
+void buildJobIndex(const vector<Job> &jobs) {
+    jobIndex.clear();
+    for (size_t i = 0; i < jobs.size(); i++) {
+        int id = jobs[i].jobID;
+        if (id < 0 || id >= MAX_JOB_ID) {
+            continue;
+        }
+        if (id >= (int)jobIndex.size()) {
+            jobIndex.resize(id + 1, -1);
+        }
+        if (jobIndex[id] == -1) {
+            jobIndex[id] = i; // First job wins if an ID is repeated
+        }
+    }
+}
+
+// Function: findJob
+// Purpose: O(1) lookup of a job by ID, nullptr if it is not in jobs
+Job *findJob(vector<Job> &jobs, int jobID) {
+    if (jobID < 0 || jobID >= (int)jobIndex.size() || jobIndex[jobID] == -1) {
+        return nullptr;
+    }
+    Job &job = jobs[jobIndex[jobID]];
+    return job.jobID == jobID ? &job : nullptr;
+}
 
 // Function to divide job into pages
 void divideJobIntoPages(Job &job) {
@@ -99,6 +712,98 @@ void divideJobIntoPages(Job &job) {
     job.pageFaults = 0;
 }
 
+// Adds a free block to its order's list
+void addBuddyBlock(int start, int order) {
+    blockOrder[start] = order;
+    blockSlot[start] = buddyFreeLists[order].size();
+    buddyFreeLists[order].push_back(start);
+    buddyOrderMask |= 1u << order;
+}
+
+// Removes a free block from its order's list (swap with the last entry)
+void removeBuddyBlock(int start) {
+    vector<int> &list = buddyFreeLists[blockOrder[start]];
+    int last = list.back();
+    list[blockSlot[start]] = last;
+    blockSlot[last] = blockSlot[start];
+    list.pop_back();
+    if (list.empty()) {
+        buddyOrderMask &= ~(1u << blockOrder[start]);
+    }
+    blockOrder[start] = -1;
+}
+
+// Function: initBuddy
+// Purpose: Covers frames [0, numFrames) with the largest aligned free blocks
+void initBuddy(int numFrames) {
+    int maxOrder = 0;
+    while ((2LL << maxOrder) <= numFrames) {
+        maxOrder++;
+    }
+    buddyFreeLists.assign(maxOrder + 1, vector<int>());
+    buddyOrderMask = 0;
+    blockOrder.assign(numFrames, -1);
+    blockSlot.assign(numFrames, -1);
+    for (int start = 0; start < numFrames;) {
+        int order = maxOrder;
+        while ((start & ((1 << order) - 1)) != 0 || start + (1 << order) > numFrames) {
+            order--;
+        }
+        addBuddyBlock(start, order);
+        start += 1 << order;
+    }
+}
+
+// Function: buddyTake
+// Purpose: Takes one free frame out of the buddy lists, splitting the block
+//          that holds it and returning the halves it does not need
+void buddyTake(int frameIndex) {
+    int order = 0;
+    int start = frameIndex;
+    while (blockOrder[start] != order) {
+        order++;
+        start = frameIndex & ~((1 << order) - 1);
+    }
+    removeBuddyBlock(start);
+    while (order > 0) {
+        order--;
+        int half = 1 << order;
+        if (frameIndex < start + half) {
+            addBuddyBlock(start + half, order);
+        } else {
+            addBuddyBlock(start, order);
+            start += half;
+        }
+    }
+}
+
+// Function: buddyFree
+// Purpose: Returns one frame, merging it with its buddy for as long as the buddy is free
+void buddyFree(int frameIndex) {
+    int start = frameIndex;
+    int order = 0;
+    while (order + 1 < (int)buddyFreeLists.size()) {
+        int buddy = start ^ (1 << order);
+        if (buddy + (1 << order) > (int)memoryFrames.size() || blockOrder[buddy] != order) {
+            break;
+        }
+        removeBuddyBlock(buddy);
+        start = min(start, buddy);
+        order++;
+    }
+    addBuddyBlock(start, order);
+}
+
+// Function: findFreeBlock
+// Purpose: Start of the smallest free block of at least 2^order frames, or -1
+int findFreeBlock(int order) {
+    uint32_t orders = order < 32 ? buddyOrderMask >> order << order : 0;
+    if (orders == 0) {
+        return -1;
+    }
+    return buddyFreeLists[__builtin_ctz(orders)].back();
+}
+
 // init mem frames
 /*
 This function allows the user to specify how 
@@ -107,281 +812,3991 @@ for each
  */
 void initFrames(int numFrames, int frameSize) {
     memoryFrames.clear();
-    fifoQueue = queue<int>(); // Clear FIFO queue
+    replacementHead = replacementTail = -1; // Clear FIFO order
     currentTime = 0;
+    dirtyFrames = 0;
+    hugePages = HugePageState(); // a run turns huge pages back on with initHugePages
+    sharing = SharedMemory();
     
     for (int i = 0; i < numFrames; i++) {
-        memoryFrames.push_back({i, frameSize, true, -1, -1, 0});
+        memoryFrames.push_back({i, frameSize, true, -1, -1, 0, -1, -1, -1, -1, false, false, false, false, 0, -1, 0});
+    }
+
+    // Every frame starts free, pushed in reverse so frame 0 is handed out first
+    freeFrames.clear();
+    freeSlot.assign(numFrames, -1);
+    for (int i = numFrames - 1; i >= 0; i--) {
+        freeSlot[i] = freeFrames.size();
+        freeFrames.push_back(i);
+    }
+    initBuddy(numFrames);
+}
+
+// Removes a specific frame from the free list (swap with the last entry)
+void takeFreeFrame(int frameIndex) {
+    int slot = freeSlot[frameIndex];
+    int last = freeFrames.back();
+    freeFrames[slot] = last;
+    freeSlot[last] = slot;
+    freeFrames.pop_back();
+    freeSlot[frameIndex] = -1;
+    buddyTake(frameIndex);
+}
+
+void returnFreeFrame(int frameIndex) {
+    freeSlot[frameIndex] = freeFrames.size();
+    freeFrames.push_back(frameIndex);
+    buddyFree(frameIndex);
+}
+
+// Function: printFreeBlocks
+// Purpose: External fragmentation: free blocks per order and the largest one
+void printFreeBlocks() {
+    int largest = -1;
+    cout << "Free Blocks  :";
+    for (size_t order = 0; order < buddyFreeLists.size(); order++) {
+        if (!buddyFreeLists[order].empty()) {
+            cout << " " << (1 << order) << "x" << buddyFreeLists[order].size();
+            largest = order;
+        }
+    }
+    if (largest == -1) {
+        cout << " none\n";
+        return;
+    }
+    cout << " (frames x blocks), largest " << (1 << largest) << " of " << freeFrames.size() << " free frames\n";
+}
+
+// Function: tlbKey
+// Purpose: Translation key of a job's page: the page itself, or its region for a huge page
+uint64_t tlbKey(int jobID, int pageNumber, bool huge) {
+    uint64_t key = (uint64_t)(uint32_t)jobID << 32;
+    return huge ? key | TLB_HUGE_BIT | (uint32_t)(pageNumber / hugePages.frames) : key | (uint32_t)pageNumber;
+}
+
+// Function: tlbAccess
+// Purpose: Looks a translation up, filling it on a miss (replacing the set's LRU way)
+void tlbAccess(uint64_t key) {
+    uint64_t *keys = &tlb.keys[((key * 0x9e3779b97f4a7c15ULL) >> 32) % tlb.sets * tlb.ways];
+    uint64_t *lastUse = &tlb.lastUse[keys - tlb.keys.data()];
+    tlb.clock++;
+    int victim = 0;
+    for (int way = 0; way < tlb.ways; way++) {
+        if (keys[way] == key) {
+            lastUse[way] = tlb.clock;
+            tlb.hits++;
+            return;
+        }
+        if (lastUse[way] < lastUse[victim]) {
+            victim = way;
+        }
+    }
+    tlb.misses++;
+    keys[victim] = key;
+    lastUse[victim] = tlb.clock;
+}
+
+// Function: tlbInvalidate
+// Purpose: Drops a translation when its page is unmapped
+void tlbInvalidate(uint64_t key) {
+    uint64_t *keys = &tlb.keys[((key * 0x9e3779b97f4a7c15ULL) >> 32) % tlb.sets * tlb.ways];
+    for (int way = 0; way < tlb.ways; way++) {
+        if (keys[way] == key) {
+            keys[way] = TLB_EMPTY;
+            tlb.lastUse[keys - tlb.keys.data() + way] = 0;
+        }
+    }
+}
+
+// Function: splitHugePage
+// Purpose: Turns the huge page starting at frame head back into base pages
+void splitHugePage(int head) {
+    if (tlb.sets > 0) {
+        tlbInvalidate(tlbKey(memoryFrames[head].jobID, memoryFrames[head].pageNumber, true));
+    }
+    for (int i = 0; i < hugePages.frames; i++) {
+        memoryFrames[head + i].hugeHead = -1;
     }
+    hugePages.mapped--;
+    hugePages.splits++;
 }
 
 // Function to find a free frame
+// The smallest free block gives it up, so large blocks stay whole for huge pages
 int findFreeFrame() {
-    for (int i = 0; i < memoryFrames.size(); i++) {
-        if (memoryFrames[i].isFree) {
-            return i;
-        }
+    STAT_INC(freeFrameScans);
+    if (freeFrames.empty()) {
+        return -1; // No free frame found
+    }
+    return findFreeBlock(0);
+}
+
+// Appends a frame at the newest end of the replacement order
+void linkReplacement(int frameIndex) {
+    PageFrame &frame = memoryFrames[frameIndex];
+    frame.prevFrame = replacementTail;
+    frame.nextFrame = -1;
+    if (replacementTail != -1) {
+        memoryFrames[replacementTail].nextFrame = frameIndex;
+    } else {
+        replacementHead = frameIndex;
+    }
+    replacementTail = frameIndex;
+}
+
+// Removes a frame from the replacement order (no-op if it is not in it)
+void unlinkReplacement(int frameIndex) {
+    PageFrame &frame = memoryFrames[frameIndex];
+    if (frame.prevFrame == -1 && replacementHead != frameIndex) {
+        return;
+    }
+    if (frame.prevFrame != -1) memoryFrames[frame.prevFrame].nextFrame = frame.nextFrame;
+    else replacementHead = frame.nextFrame;
+    if (frame.nextFrame != -1) memoryFrames[frame.nextFrame].prevFrame = frame.prevFrame;
+    else replacementTail = frame.prevFrame;
+    frame.prevFrame = frame.nextFrame = -1;
+}
+
+// Pushes a frame onto the front (newest end) of a job's resident list
+void linkResident(Job &job, int frameIndex) {
+    memoryFrames[frameIndex].jobPrevFrame = -1;
+    memoryFrames[frameIndex].jobNextFrame = job.residentHead;
+    if (job.residentHead != -1) {
+        memoryFrames[job.residentHead].jobPrevFrame = frameIndex;
     }
-    return -1; // No free frame found
+    job.residentHead = frameIndex;
+    if (job.residentTail == -1) {
+        job.residentTail = frameIndex;
+    }
+    job.residentCount++;
+}
+
+// Removes a frame from a job's resident list
+void unlinkResident(Job &job, int frameIndex) {
+    PageFrame &frame = memoryFrames[frameIndex];
+    if (frame.jobPrevFrame != -1) memoryFrames[frame.jobPrevFrame].jobNextFrame = frame.jobNextFrame;
+    else job.residentHead = frame.jobNextFrame;
+    if (frame.jobNextFrame != -1) memoryFrames[frame.jobNextFrame].jobPrevFrame = frame.jobPrevFrame;
+    else job.residentTail = frame.jobPrevFrame;
+    frame.jobPrevFrame = frame.jobNextFrame = -1;
+    job.residentCount--;
 }
 
 // Function: fifoReplacement
 // Purpose: Implements FIFO page replacement algorithm
 int fifoReplacement() {
-    if (fifoQueue.empty()) {
+    if (replacementHead == -1) {
         return 0; // Fallback to frame 0
     }
     
-    int frameToReplace = fifoQueue.front();
-    fifoQueue.pop();
+    int frameToReplace = replacementHead;
+    unlinkReplacement(frameToReplace);
     return frameToReplace;
 }
 
-
-// Function: loadPage
-// Purpose: Loads a specific page into memory using demand paging with FIFO replacement
-bool loadPage(Job &job, int pageNumber, vector<Job> &allJobs) {
-    // Check if page is already loaded
-    if (job.loadedPages.find(pageNumber) != job.loadedPages.end()) {
-        // Page hit - update access time
-        for (auto &frame : memoryFrames) {
-            if (!frame.isFree && frame.jobID == job.jobID && frame.pageNumber == pageNumber) {
-                frame.accessTime = currentTime;
+// Function: chooseVictim
+// Purpose: Picks the global victim frame for the current replacement policy
+//          (the frame is left to the caller to evict)
+int chooseVictim() {
+    if (replacementPolicy == POLICY_FIFO || replacementHead == -1) {
+        return fifoReplacement();
+    }
+    int best = replacementHead;
+    int bestClass = 4;
+    for (int frameIndex = replacementHead; frameIndex != -1; frameIndex = memoryFrames[frameIndex].nextFrame) {
+        STAT_INC(victimScanFrames);
+        const PageFrame &frame = memoryFrames[frameIndex];
+        int pageClass = replacementPolicy == POLICY_NRU ? frame.referenced * 2 + frame.modified : frame.modified;
+        if (pageClass < bestClass) {
+            best = frameIndex;
+            bestClass = pageClass;
+            if (pageClass == 0) {
                 break;
             }
         }
-        return true;
     }
+    return best;
+}
+
+// Function: resetReferencedBits
+// Purpose: NRU's periodic clear, so "referenced" means referenced recently
+void resetReferencedBits() {
+    for (auto &frame : memoryFrames) {
+        frame.referenced = false;
+    }
+}
+
+
+// Function: mapPageToFrame
+// Purpose: Places a job's page into a free frame and updates the job's tables,
+//          its resident list and the replacement order
+void mapPageToFrame(Job &job, int pageNumber, int frameIndex) {
+    takeFreeFrame(frameIndex);
+    memoryFrames[frameIndex].isFree = false;
+    memoryFrames[frameIndex].jobID = job.jobID;
+    memoryFrames[frameIndex].pageNumber = pageNumber;
+    memoryFrames[frameIndex].accessTime = currentTime;
+    memoryFrames[frameIndex].modified = false;
+    memoryFrames[frameIndex].referenced = true;
+    memoryFrames[frameIndex].prefetched = false;
+    memoryFrames[frameIndex].prepaged = false;
+    memoryFrames[frameIndex].readyTime = 0;
+    memoryFrames[frameIndex].mapCount = 1;
     
-    // Page fault occurred
-    job.pageFaults++;
-    currentTime++;
+    // Update job's page table and loaded pages
+    job.pageTable[pageNumber] = memoryFrames[frameIndex].frameID;
+    job.loadedPages.insert(pageNumber);
+
+    // Push onto the front of the job's resident list
+    linkResident(job, frameIndex);
     
-    // Try to find a free frame first
-    int frameIndex = findFreeFrame();
+    // Add to FIFO order
+    linkReplacement(frameIndex);
+}
+
+// Function: unmapSharers
+// Purpose: Removes every non-owner mapping of a shared frame that is leaving memory
+void unmapSharers(int frameIndex) {
+    auto it = sharing.mappers.find(frameIndex);
+    if (it == sharing.mappers.end()) {
+        return;
+    }
+    for (auto &mapping : it->second) {
+        Job *mapper = sharing.jobs ? findJob(*sharing.jobs, mapping.first) : nullptr;
+        if (mapper != nullptr) {
+            mapper->pageTable.erase(mapping.second);
+            mapper->loadedPages.erase(mapping.second);
+            mapper->sharedPages--;
+        }
+        if (tlb.sets > 0) {
+            tlbInvalidate(tlbKey(mapping.first, mapping.second, false));
+        }
+    }
+    sharing.extraMappings -= it->second.size();
+    sharing.unmappedByEviction += it->second.size();
+    sharing.mappers.erase(it);
+    memoryFrames[frameIndex].mapCount = 1;
+}
+
+// Function: unshareMapping
+// Purpose: Drops one job's mapping of a shared frame, leaving the frame to its
+//          other mappers (the next one becomes its owner if this job owned it).
+//          Returns false if the frame is not shared: the caller releases it.
+bool unshareMapping(Job &job, int pageNumber, int frameIndex) {
+    PageFrame &frame = memoryFrames[frameIndex];
+    if (frame.mapCount <= 1) {
+        return false;
+    }
+    if (frameIndex == zeroPage.frame) {
+        // Its mappings are only counted: there is no mapper list to update
+        frame.mapCount--;
+        sharing.extraMappings--;
+        job.sharedPages--;
+        job.pageTable.erase(pageNumber);
+        job.loadedPages.erase(pageNumber);
+        if (tlb.sets > 0) {
+            tlbInvalidate(tlbKey(job.jobID, pageNumber, false));
+        }
+        return true;
+    }
+    vector<pair<int, int>> &mappers = sharing.mappers[frameIndex];
+    if (frame.jobID == job.jobID && frame.pageNumber == pageNumber) {
+        // The owner lets go: hand the frame, and its charge, to another mapper,
+        // preferring one with room under its local quota. If none has room the
+        // heir goes over its quota and sheds its oldest pages on its next fault.
+        bool local = replacementScope == LOCAL_REPLACEMENT || replacementScope == PFF_REPLACEMENT;
+        for (size_t i = 0; local && i + 1 < mappers.size(); i++) {
+            Job *mapper = findJob(*sharing.jobs, mappers[i].first);
+            if (mapper->frameQuota == 0 || mapper->residentCount < mapper->frameQuota) {
+                swap(mappers[i], mappers.back());
+                break;
+            }
+        }
+        Job *heir = findJob(*sharing.jobs, mappers.back().first);
+        unlinkResident(job, frameIndex);
+        frame.jobID = mappers.back().first;
+        frame.pageNumber = mappers.back().second;
+        mappers.pop_back();
+        linkResident(*heir, frameIndex);
+        heir->sharedPages--;
+        sharing.handovers++;
+    } else {
+        for (size_t i = 0; i < mappers.size(); i++) {
+            if (mappers[i].first == job.jobID && mappers[i].second == pageNumber) {
+                mappers[i] = mappers.back();
+                mappers.pop_back();
+                break;
+            }
+        }
+        job.sharedPages--;
+    }
+    if (mappers.empty()) {
+        sharing.mappers.erase(frameIndex);
+    }
+    frame.mapCount--;
+    sharing.extraMappings--;
+    job.pageTable.erase(pageNumber);
+    job.loadedPages.erase(pageNumber);
+    if (tlb.sets > 0) {
+        tlbInvalidate(tlbKey(job.jobID, pageNumber, false));
+    }
+    return true;
+}
+
+// Function: unmapSharedPages
+// Purpose: Drops the mappings a job holds on frames other jobs own
+void unmapSharedPages(Job &job) {
+    while (job.sharedPages > 0 && !job.pageTable.empty()) {
+        auto it = job.pageTable.begin();
+        unshareMapping(job, it->first, it->second);
+    }
+}
+
+// Function: releaseFrame
+// Purpose: Takes a page out of its frame: clears the owner's tables (and those
+//          of any job sharing it), unlinks the frame from both lists and
+//          returns it to the free list. `evicted` is false when the owner is
+//          exiting or being swapped out: its unused prefetched and prepaged
+//          pages were not wasted by a bad guess, so they are not counted.
+void releaseFrame(Job &owner, int frameIndex, bool evicted = true) {
+    PageFrame &frame = memoryFrames[frameIndex];
+    if (frame.mapCount > 1) {
+        unmapSharers(frameIndex);
+    }
+    if (frame.hugeHead != -1) {
+        splitHugePage(frame.hugeHead);
+    }
+    if (tlb.sets > 0) {
+        tlbInvalidate(tlbKey(owner.jobID, frame.pageNumber, false));
+    }
+    owner.loadedPages.erase(frame.pageNumber);
+    owner.pageTable.erase(frame.pageNumber);
+    unlinkResident(owner, frameIndex);
+    if (frame.modified) {
+        frame.modified = false;
+        dirtyFrames--;
+    }
+    if (frame.prefetched && evicted) {
+        // Read ahead for nothing: shrink the owner's window
+        owner.readaheadWindow = max(readaheadMin, owner.readaheadWindow / 2);
+        STAT_INC(prefetchWasted);
+    }
+    if (frame.prepaged && evicted) {
+        STAT_INC(prepageWasted);
+    }
+    frame.prefetched = false;
+    frame.prepaged = false;
+
+    unlinkReplacement(frameIndex);
+    frame.isFree = true;
+    frame.jobID = -1;
+    frame.pageNumber = -1;
+    frame.mapCount = 0;
+    returnFreeFrame(frameIndex);
+}
+
+// Function: terminateJob
+// Purpose: Releases every frame a job holds, walking only its resident list.
+//          The job stays in the job table; a later reference starts it again
+//          from an empty resident set.
+int terminateJob(Job &job) {
+    int released = 0;
+    while (job.residentHead != -1) {
+        int frameIndex = job.residentHead;
+        if (!unshareMapping(job, memoryFrames[frameIndex].pageNumber, frameIndex)) {
+            releaseFrame(job, frameIndex, false);
+            released++;
+        }
+    }
+    unmapSharedPages(job);
+    STAT_INC(terminations);
+    STAT_ADD(framesReclaimed, released);
+
+    // A restarted job begins with an empty working set
+    if (!job.window.empty()) {
+        fill(job.window.begin(), job.window.end(), -1);
+        fill(job.windowCount.begin(), job.windowCount.end(), 0);
+        job.windowPos = 0;
+        job.workingSetSize = 0;
+    }
+    job.lastFaultPage = -2;
+    job.readaheadEnd = -1;
+    job.readaheadWindow = 0;
+    job.lastStride = 0;
+    job.strideConfidence = 0;
+    job.started = false;
+    job.restorePending = false;
+    job.savedWorkingSet.clear();
+    fill(job.written.begin(), job.written.end(), false); // it starts again from its program image
+    return released;
+}
+
+// Function: writeBackIfDirty
+// Purpose: Queues the write-back of a modified page that is about to be evicted
+void writeBackIfDirty(int frameIndex) {
+    if (memoryFrames[frameIndex].modified) {
+        pendingWriteBacks++;
+        STAT_INC(writeBacks);
+    }
+}
+
+// Function: evictFrame
+// Purpose: Frees an occupied frame, updating the tables of the job that owned it
+void evictFrame(int frameIndex, vector<Job> &allJobs) {
+    STAT_INC(evictions);
+    writeBackIfDirty(frameIndex);
     
-    if (frameIndex == -1) {
-        // No free frames, use FIFO replacement
-        frameIndex = fifoReplacement();
-        
-        // Remove the old page from its job's loaded pages
-        if (!memoryFrames[frameIndex].isFree) {
-            int oldJobID = memoryFrames[frameIndex].jobID;
-            int oldPageNumber = memoryFrames[frameIndex].pageNumber;
-            
-            // Find and update the old job
-            for (auto &j : allJobs) {
-                if (j.jobID == oldJobID) {
-                    j.loadedPages.erase(oldPageNumber);
-                    j.pageTable.erase(oldPageNumber);
-                    break;
+    // Find and update the old job
+    STAT_INC(victimLookupIterations);
+    Job *oldJob = findJob(allJobs, memoryFrames[frameIndex].jobID);
+    if (oldJob != nullptr) {
+        releaseFrame(*oldJob, frameIndex);
+    } else {
+        // Owner is not in this job table, just free the frame
+        unmapSharers(frameIndex);
+        if (memoryFrames[frameIndex].hugeHead != -1) {
+            splitHugePage(memoryFrames[frameIndex].hugeHead);
+        }
+        unlinkReplacement(frameIndex);
+        if (memoryFrames[frameIndex].modified) {
+            memoryFrames[frameIndex].modified = false;
+            dirtyFrames--;
+        }
+        memoryFrames[frameIndex].isFree = true;
+        memoryFrames[frameIndex].jobID = -1;
+        memoryFrames[frameIndex].pageNumber = -1;
+        memoryFrames[frameIndex].mapCount = 0;
+        returnFreeFrame(frameIndex);
+    }
+}
+
+// Function: computeFrameQuotas
+// Purpose: Splits the frames between the jobs for local replacement.
+//          Every job gets at least one frame; leftovers go to the largest remainders.
+void computeFrameQuotas(vector<Job> &jobs, QuotaPolicy policy) {
+    if (jobs.empty()) {
+        return;
+    }
+    vector<double> weight(jobs.size());
+    double totalWeight = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (policy == QUOTA_EQUAL) weight[i] = 1;
+        else if (policy == QUOTA_PROPORTIONAL) weight[i] = jobs[i].jobSize;
+        else weight[i] = max(jobs[i].priority, 1);
+        totalWeight += weight[i];
+    }
+
+    int totalFrames = memoryFrames.size();
+    int assigned = 0;
+    vector<pair<double, int>> remainders;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        double share = totalFrames * weight[i] / totalWeight;
+        jobs[i].frameQuota = max(1, (int)share);
+        assigned += jobs[i].frameQuota;
+        remainders.push_back({share - (int)share, (int)i});
+    }
+    sort(remainders.rbegin(), remainders.rend());
+    for (size_t r = 0; r < remainders.size() && assigned < totalFrames; r++, assigned++) {
+        jobs[remainders[r].second].frameQuota++;
+    }
+}
+
+// Function: adjustFaultFrequency
+// Purpose: PFF controller, run on each of the job's faults before a frame is chosen
+void adjustFaultFrequency(Job &job) {
+    long long interval = job.references - job.lastFaultReference;
+    int previousFault = job.lastFaultTime;
+    job.lastFaultReference = job.references;
+    job.lastFaultTime = currentTime;
+
+    if (interval * pffUpperRate < 1.0) {
+        // Faulting too often: allow one more frame, as long as memory has one to give
+        if (job.residentCount >= job.frameQuota && !freeFrames.empty()) {
+            job.frameQuota++;
+            STAT_INC(quotaGrows);
+        }
+    } else if (interval * pffLowerRate > 1.0) {
+        // Faulting rarely: drop the pages it has not touched since its last fault
+        int frameIndex = job.residentHead;
+        while (frameIndex != -1) {
+            int next = memoryFrames[frameIndex].jobNextFrame;
+            if (memoryFrames[frameIndex].accessTime < previousFault) {
+                if (!unshareMapping(job, memoryFrames[frameIndex].pageNumber, frameIndex)) {
+                    writeBackIfDirty(frameIndex);
+                    releaseFrame(job, frameIndex);
+                }
+                STAT_INC(pffReleased);
+            }
+            frameIndex = next;
+        }
+        job.frameQuota = job.residentCount + 1; // room for the page being loaded
+        STAT_INC(quotaShrinks);
+    }
+}
+
+// Function: updateWorkingSet
+// Purpose: Slides the job's window forward by one reference in O(1): the new page
+//          comes in, the page referenced workingSetWindow references ago drops out
+void updateWorkingSet(Job &job, int pageNumber) {
+    if (job.window.empty()) {
+        job.window.assign(workingSetWindow, -1);
+        job.windowCount.assign(job.pages.size(), 0);
+    }
+    int leaving = job.window[job.windowPos];
+    job.window[job.windowPos] = pageNumber;
+    job.windowPos = (job.windowPos + 1 == (int)job.window.size()) ? 0 : job.windowPos + 1;
+
+    if (job.windowCount[pageNumber]++ == 0) {
+        job.workingSetSize++;
+    }
+    if (leaving != -1 && --job.windowCount[leaving] == 0) {
+        job.workingSetSize--;
+        if (replacementScope == WORKING_SET_REPLACEMENT) {
+            auto it = job.pageTable.find(leaving);
+            if (it != job.pageTable.end()) {
+                int frameIndex = it->second;
+                if (!unshareMapping(job, leaving, frameIndex)) {
+                    writeBackIfDirty(frameIndex);
+                    releaseFrame(job, frameIndex);
+                }
+                STAT_INC(workingSetReleases);
+            }
+        }
+    }
+    job.workingSetSum += job.workingSetSize;
+    job.workingSetMax = max(job.workingSetMax, job.workingSetSize);
+}
+
+// Function: obtainFrame
+// Purpose: Finds a frame for one more page of `job`: a free frame, or a victim
+//          chosen by the replacement scope and policy (evicted before returning).
+//          Returns -1, evicting nothing, if the victim would be pinnedFrame.
+int obtainFrame(Job &job, vector<Job> &allJobs) {
+    // Local replacement: a job at its quota replaces one of its own pages
+    bool local = (replacementScope == LOCAL_REPLACEMENT || replacementScope == PFF_REPLACEMENT) && job.residentCount > 0;
+    bool atQuota = local && job.frameQuota > 0 && job.residentCount >= job.frameQuota;
+    
+    // Try to find a free frame first
+    int frameIndex = atQuota ? -1 : findFreeFrame();
+    
+    if (frameIndex == -1 && pinnedFrame != -1) {
+        // Every frame this would evict must be one other than the pinned one
+        int victims = atQuota ? job.residentCount - job.frameQuota + 1 : 1;
+        int victim = local ? job.residentTail
+                           : (replacementPolicy == POLICY_FIFO ? replacementHead : chooseVictim());
+        for (; victim != -1 && victims > 0; victims--) {
+            if (victim == pinnedFrame) {
+                return -1;
+            }
+            victim = local ? memoryFrames[victim].jobPrevFrame : -1;
+        }
+    }
+    
+    if (frameIndex == -1) {
+        if (local) {
+            // Oldest page of this job's own resident set, and any more that
+            // put it over its quota (shared frames it inherited)
+            do {
+                frameIndex = job.residentTail;
+                writeBackIfDirty(frameIndex);
+                releaseFrame(job, frameIndex);
+                STAT_INC(evictions);
+            } while (atQuota && job.residentCount >= job.frameQuota);
+        } else {
+            // No free frames, pick a victim by the replacement policy
+            frameIndex = chooseVictim();
+            
+            // Remove the old page from its job's loaded pages
+            if (!memoryFrames[frameIndex].isFree) {
+                evictFrame(frameIndex, allJobs);
+            }
+        }
+    }
+    return frameIndex;
+}
+
+// Function: reclaimHugeBlock
+// Purpose: Lumpy reclaim: evicts the policy's victim and every other page in
+//          its aligned block. Returns the block, or -1 if the victim sits in
+//          the partial block at the end of memory (its frame is still freed).
+int reclaimHugeBlock(vector<Job> &allJobs) {
+    int victim = chooseVictim();
+    if (!memoryFrames[victim].isFree) {
+        evictFrame(victim, allJobs);
+    }
+    int block = victim / hugePages.frames;
+    if ((block + 1) * hugePages.frames > (int)memoryFrames.size() ||
+        (zeroPage.frame != -1 && zeroPage.frame / hugePages.frames == block)) {
+        return -1; // the partial block at the end, or the one the zero frame pins
+    }
+    for (int frame = block * hugePages.frames; frame < (block + 1) * hugePages.frames; frame++) {
+        if (!memoryFrames[frame].isFree) {
+            evictFrame(frame, allJobs);
+        }
+    }
+    hugePages.lumpyReclaims++;
+    return block;
+}
+
+// Function: migratePage
+// Purpose: Moves the page in frame `from` to the free frame `to`. It keeps its
+//          bits, its age in the replacement order and its place in the owner's
+//          resident list; only its page table entry (and TLB entry) change.
+bool migratePage(int from, int to, vector<Job> &allJobs) {
+    Job *owner = findJob(allJobs, memoryFrames[from].jobID);
+    if (owner == nullptr || memoryFrames[from].hugeHead != -1 || memoryFrames[from].mapCount > 1) {
+        return false;
+    }
+    takeFreeFrame(to);
+    PageFrame &src = memoryFrames[from];
+    PageFrame &dst = memoryFrames[to];
+    int frameID = dst.frameID;
+    dst = src;
+    dst.frameID = frameID;
+
+    if (src.prevFrame != -1) memoryFrames[src.prevFrame].nextFrame = to;
+    else if (replacementHead == from) replacementHead = to;
+    if (src.nextFrame != -1) memoryFrames[src.nextFrame].prevFrame = to;
+    else if (replacementTail == from) replacementTail = to;
+    if (src.jobPrevFrame != -1) memoryFrames[src.jobPrevFrame].jobNextFrame = to;
+    else owner->residentHead = to;
+    if (src.jobNextFrame != -1) memoryFrames[src.jobNextFrame].jobPrevFrame = to;
+    else owner->residentTail = to;
+    owner->pageTable[src.pageNumber] = to;
+    if (tlb.sets > 0) {
+        tlbInvalidate(tlbKey(owner->jobID, src.pageNumber, false));
+    }
+
+    src.isFree = true;
+    src.jobID = src.pageNumber = -1;
+    src.prevFrame = src.nextFrame = src.jobPrevFrame = src.jobNextFrame = -1;
+    src.modified = src.referenced = src.prefetched = src.prepaged = false;
+    src.readyTime = 0;
+    src.mapCount = 0;
+    returnFreeFrame(from);
+    compaction.migrations++;
+    return true;
+}
+
+// Function: compactBlock
+// Purpose: Frees an aligned block of 2^order frames by migrating its pages out.
+//          Returns its first frame, or -1 if no block can be emptied.
+int compactBlock(int order, vector<Job> &allJobs) {
+    int size = 1 << order;
+    int best = -1;
+    int bestFree = -1;
+    for (int start = 0; start + size <= (int)memoryFrames.size(); start += size) {
+        int free = 0;
+        bool movable = true;
+        for (int frame = start; frame < start + size && movable; frame++) {
+            free += memoryFrames[frame].isFree;
+            movable = memoryFrames[frame].hugeHead == -1 && memoryFrames[frame].mapCount <= 1 && frame != zeroPage.frame;
+        }
+        if (movable && free > bestFree) {
+            best = start;
+            bestFree = free;
+        }
+    }
+    // The pages moved out need free frames outside the block
+    if (best == -1 || (int)freeFrames.size() - bestFree < size - bestFree) {
+        compaction.failures++;
+        return -1;
+    }
+
+    compaction.runs++;
+    for (int frame = best; frame < best + size; frame++) {
+        if (memoryFrames[frame].isFree) {
+            continue;
+        }
+        // Search the free stack from its top: only frames inside the block
+        // (at most `size` of them) are passed over
+        int to = -1;
+        for (size_t i = freeFrames.size(); i-- > 0 && to == -1;) {
+            if (freeFrames[i] < best || freeFrames[i] >= best + size) {
+                to = freeFrames[i];
+            }
+        }
+        if (to == -1 || !migratePage(frame, to, allJobs)) {
+            compaction.failures++;
+            return -1;
+        }
+        pendingMigrationTime += compaction.migrateCost;
+    }
+    return best;
+}
+
+// Function: mapHugePage
+// Purpose: Maps the whole region around pageNumber as one huge page.
+//          Returns the frame holding pageNumber, or -1 to fall back to a base page.
+int mapHugePage(Job &job, int pageNumber, vector<Job> &allJobs) {
+    int H = hugePages.frames;
+    int first = pageNumber - pageNumber % H;
+    if ((int)job.pages.size() < hugePages.minPages || first + H > (int)job.pages.size()) {
+        return -1; // not eligible: a small job, or the tail of the job
+    }
+    bool local = job.frameQuota > 0 && replacementScope != GLOBAL_REPLACEMENT;
+    for (int page = first; page < first + H; page++) {
+        if (job.loadedPages.count(page)) {
+            hugePages.fallbacks++; // part of the region is already resident (it was split)
+            return -1;
+        }
+    }
+    int head = findFreeBlock(hugePages.order);
+    if (head == -1 && (int)freeFrames.size() >= H) {
+        hugePages.fragmentedFailures++;
+        if (compaction.enabled) {
+            head = compactBlock(hugePages.order, allJobs);
+        }
+    }
+    if (head == -1 && !local) {
+        int block = reclaimHugeBlock(allJobs);
+        head = block == -1 ? -1 : block * H;
+    }
+    if (head == -1 || (local && job.residentCount + H > job.frameQuota)) {
+        hugePages.fallbacks++;
+        return -1;
+    }
+
+    for (int i = 0; i < H; i++) {
+        mapPageToFrame(job, first + i, head + i);
+        memoryFrames[head + i].hugeHead = head;
+    }
+    hugePages.mapped++;
+    hugePages.allocations++;
+    pendingHugeRead += H - 1; // the rest of the region comes in with the faulting page
+    return head + pageNumber - first;
+}
+
+// Function: collapseRegion
+// Purpose: Promotes a fully resident region of base pages to a huge page by
+//          copying its pages into a free (or compacted) aligned block. If a
+//          page cannot be moved, the ones already moved go back and it fails.
+bool collapseRegion(Job &job, int first, vector<Job> &allJobs) {
+    int head = findFreeBlock(hugePages.order);
+    if (head == -1 && compaction.enabled && (int)freeFrames.size() >= 2 * hugePages.frames) {
+        head = compactBlock(hugePages.order, allJobs);
+    }
+    if (head == -1) {
+        promoter.failures++;
+        return false;
+    }
+    vector<int> from(hugePages.frames);
+    int moved = 0;
+    for (; moved < hugePages.frames; moved++) {
+        from[moved] = job.pageTable[first + moved];
+        if (!migratePage(from[moved], head + moved, allJobs)) {
+            break;
+        }
+    }
+    if (moved < hugePages.frames) {
+        // The frames they left are still free: nothing ran in between
+        for (int i = 0; i < moved; i++) {
+            migratePage(head + i, from[i], allJobs);
+        }
+        promoter.failures++;
+        return false;
+    }
+    for (int i = 0; i < hugePages.frames; i++) {
+        memoryFrames[head + i].hugeHead = head;
+    }
+    hugePages.mapped++;
+    promoter.collapses++;
+    return true;
+}
+
+// Function: runPromoter
+// Purpose: khugepaged: every `interval` references, scans the next regions
+//          for ones that are fully resident in base pages and collapses them
+void runPromoter(vector<Job> &allJobs) {
+    if (++promoter.sinceWake < promoter.interval || allJobs.empty()) {
+        return;
+    }
+    promoter.sinceWake = 0;
+    promoter.wakeups++;
+    uint64_t faultMigrationTime = pendingMigrationTime; // background copies are reported, not charged
+    int H = hugePages.frames;
+    int scanned = 0;
+    for (size_t visited = 0; scanned < promoter.scanRegions && visited <= allJobs.size();) {
+        Job &job = allJobs[promoter.jobCursor % allJobs.size()];
+        int regions = (int)job.pages.size() >= hugePages.minPages ? job.pages.size() / H : 0;
+        if (promoter.regionCursor >= regions || job.suspended) {
+            promoter.jobCursor = (promoter.jobCursor + 1) % allJobs.size();
+            promoter.regionCursor = 0;
+            visited++;
+            continue;
+        }
+        int first = promoter.regionCursor++ * H;
+        scanned++;
+        int resident = 0;
+        for (int page = first; page < first + H; page++) {
+            auto it = job.pageTable.find(page);
+            if (it == job.pageTable.end() || memoryFrames[it->second].hugeHead != -1 ||
+                memoryFrames[it->second].mapCount > 1) {
+                break;
+            }
+            resident++;
+        }
+        if (resident == H && !collapseRegion(job, first, allJobs)) {
+            break; // no block for it (memory too full or fragmented) or a page would not move: try next time
+        }
+    }
+    promoter.regionsScanned += scanned;
+    pendingMigrationTime = faultMigrationTime;
+}
+
+// Function: prefetchWindow
+// Purpose: Pages the job may prefetch now: its adaptive window, capped so that
+//          prefetching never makes the faulting page itself the next victim
+int prefetchWindow(Job &job) {
+    if (job.readaheadWindow == 0) {
+        job.readaheadWindow = readaheadMin;
+    }
+    int window = min(job.readaheadWindow, (int)memoryFrames.size() / 4);
+    if (job.frameQuota > 0 && replacementScope != GLOBAL_REPLACEMENT) {
+        window = min(window, job.frameQuota / 2);
+    }
+    return window;
+}
+
+// Function: prefetchPage
+// Purpose: Loads one predicted page if it is in the job and not resident.
+//          Coalesced pages ride on the fault's read; others get their own read.
+//          Returns false once no frame can be had without evicting the
+//          referenced page: the prefetcher stops there.
+bool prefetchPage(Job &job, int page, vector<Job> &allJobs, bool coalesced) {
+    if (page < 0 || page >= (int)job.pages.size() || job.loadedPages.count(page) ||
+        (zeroPage.frame != -1 && !job.written[page])) {
+        return true; // resident already, or never written: nothing on swap to read
+    }
+    int frameIndex = obtainFrame(job, allJobs);
+    if (frameIndex == -1) {
+        return false;
+    }
+    mapPageToFrame(job, page, frameIndex);
+    memoryFrames[frameIndex].referenced = false;
+    memoryFrames[frameIndex].prefetched = true;
+    if (coalesced) {
+        pendingReadahead++;
+    } else {
+        pendingPrefetchFrames.push_back(frameIndex);
+    }
+    STAT_INC(prefetchedPages);
+    return true;
+}
+
+// Function: readAhead
+// Purpose: After a fault on pageNumber, detects sequential access and loads
+//          the next pages of the job's read-ahead window
+void readAhead(Job &job, int pageNumber, vector<Job> &allJobs) {
+    bool sequential = pageNumber == job.lastFaultPage + 1 || pageNumber == job.readaheadEnd;
+    if (!sequential) {
+        return;
+    }
+    int window = prefetchWindow(job);
+    int page = pageNumber + 1;
+    for (; page <= pageNumber + window && page < (int)job.pages.size(); page++) {
+        if (!prefetchPage(job, page, allJobs, true)) {
+            break;
+        }
+    }
+    job.readaheadEnd = page;
+}
+
+// Function: stridePrefetch
+// Purpose: Trains the job's stride detector on pageNumber and, once a stride
+//          has repeated, prefetches the next window pages along it
+void stridePrefetch(Job &job, int pageNumber, vector<Job> &allJobs) {
+    if (job.lastFaultPage < 0) {
+        return;
+    }
+    int stride = pageNumber - job.lastFaultPage;
+    if (stride == job.lastStride) {
+        job.strideConfidence = min(job.strideConfidence + 1, 3);
+    } else if (job.strideConfidence > 0) {
+        job.strideConfidence--; // one irregular step does not lose a stable stride
+        return;
+    } else {
+        job.lastStride = stride;
+        return;
+    }
+    if (stride == 0 || job.strideConfidence < 2) {
+        return;
+    }
+    int window = prefetchWindow(job);
+    for (int k = 1; k <= window; k++) {
+        if (!prefetchPage(job, pageNumber + k * stride, allJobs, false)) {
+            break;
+        }
+    }
+}
+
+// Function: markovSlot
+// Purpose: The Markov table entry that (jobID, page) maps to
+MarkovEntry &markovSlot(int jobID, int page) {
+    uint64_t key = ((uint64_t)(uint32_t)jobID << 32) | (uint32_t)page;
+    return markovTable[((key * 0x9e3779b97f4a7c15ULL) >> 32) % markovTable.size()];
+}
+
+// Function: markovPrefetch
+// Purpose: Records the transition from the job's previous fault to pageNumber,
+//          then prefetches along the most likely successor chain from pageNumber
+void markovPrefetch(Job &job, int pageNumber, vector<Job> &allJobs) {
+    if (job.lastFaultPage >= 0) {
+        MarkovEntry &entry = markovSlot(job.jobID, job.lastFaultPage);
+        if (entry.jobID != job.jobID || entry.page != job.lastFaultPage) {
+            entry = MarkovEntry(); // another page owned this slot; the table is bounded
+            entry.jobID = job.jobID;
+            entry.page = job.lastFaultPage;
+        }
+        if (entry.next[0] == pageNumber) {
+            entry.count[0] = min(entry.count[0] + 1, 65535);
+        } else if (entry.next[1] == pageNumber) {
+            entry.count[1] = min(entry.count[1] + 1, 65535);
+            if (entry.count[1] > entry.count[0]) {
+                swap(entry.next[0], entry.next[1]);
+                swap(entry.count[0], entry.count[1]);
+            }
+        } else if (entry.next[0] == -1) {
+            entry.next[0] = pageNumber;
+            entry.count[0] = 1;
+        } else {
+            entry.next[1] = pageNumber; // replaces the less frequent successor
+            entry.count[1] = 1;
+        }
+    }
+
+    // Each step of the chain, and the second successor of the first, takes one page of the window
+    int window = prefetchWindow(job);
+    int page = pageNumber;
+    for (int depth = 0; window > 0; depth++) {
+        const MarkovEntry &entry = markovSlot(job.jobID, page);
+        if (entry.jobID != job.jobID || entry.page != page || entry.next[0] == -1) {
+            break;
+        }
+        int second = entry.next[1];
+        page = entry.next[0];
+        window--;
+        if (!prefetchPage(job, page, allJobs, false)) {
+            break;
+        }
+        if (depth == 0 && second != -1 && window > 0) {
+            window--;
+            if (!prefetchPage(job, second, allJobs, false)) {
+                break;
+            }
+        }
+    }
+}
+
+// Function: runPrefetcher
+// Purpose: Runs the selected prefetcher after a fault (or prefetch hit) on
+//          pageNumber, once the reference is done with its frame. That frame
+//          is pinned: prefetching stops rather than evict it.
+void runPrefetcher(Job &job, int pageNumber, vector<Job> &allJobs) {
+    pinnedFrame = job.pageTable[pageNumber];
+    switch (prefetcher) {
+    case PREFETCH_READAHEAD:
+        readAhead(job, pageNumber, allJobs);
+        break;
+    case PREFETCH_STRIDE:
+        stridePrefetch(job, pageNumber, allJobs);
+        break;
+    case PREFETCH_MARKOV:
+        markovPrefetch(job, pageNumber, allJobs);
+        break;
+    case PREFETCH_NONE:
+        break;
+    }
+#ifdef PAGING_CHECKS
+    auto mapped = job.pageTable.find(pageNumber);
+    if (mapped == job.pageTable.end() || mapped->second != pinnedFrame || memoryFrames[pinnedFrame].isFree) {
+        cerr << "Prefetching evicted the referenced page " << pageNumber << " of job " << job.jobID << endl;
+        abort();
+    }
+#endif
+    pinnedFrame = -1;
+    job.lastFaultPage = pageNumber;
+}
+
+// Function: prepageJob
+// Purpose: Loads `pages` for a job that is starting or resuming, as one batch.
+//          Stops at half of memory (or of the job's quota under local scopes)
+//          so the batch cannot push out the pages it just loaded.
+void prepageJob(Job &job, const vector<int> &pages, vector<Job> &allJobs) {
+    int limit = memoryFrames.size() / 2;
+    if (job.frameQuota > 0 && replacementScope != GLOBAL_REPLACEMENT) {
+        limit = min(limit, job.frameQuota / 2);
+    }
+    int loaded = 0;
+    for (size_t i = 0; i < pages.size() && loaded < limit; i++) {
+        int page = pages[i];
+        if (page < 0 || page >= (int)job.pages.size() || job.loadedPages.count(page) ||
+            (zeroPage.frame != -1 && !job.written[page])) {
+            continue;
+        }
+        int frameIndex = obtainFrame(job, allJobs);
+        mapPageToFrame(job, page, frameIndex);
+        memoryFrames[frameIndex].referenced = false;
+        memoryFrames[frameIndex].prepaged = true;
+        pendingPrepage++;
+        loaded++;
+    }
+    STAT_ADD(prepagedPages, loaded);
+}
+
+// Function: cloneJob
+// Purpose: Fork: maps every page the parent has in memory into the child as a
+//          shared copy-on-write page. Only page table entries are copied.
+void cloneJob(Job &parent, Job &child, vector<Job> &allJobs) {
+    sharing.jobs = &allJobs;
+    int shared = 0;
+    for (const auto &entry : parent.pageTable) {
+        int page = entry.first;
+        int frameIndex = entry.second;
+        if (page >= (int)child.pages.size() || child.loadedPages.count(page)) {
+            continue;
+        }
+        if (memoryFrames[frameIndex].hugeHead != -1) {
+            splitHugePage(memoryFrames[frameIndex].hugeHead); // shared pages are base pages
+        }
+        if (frameIndex != zeroPage.frame) {
+            sharing.mappers[frameIndex].push_back({child.jobID, page});
+        }
+        memoryFrames[frameIndex].mapCount++;
+        child.pageTable[page] = frameIndex;
+        child.loadedPages.insert(page);
+        shared++;
+    }
+    if (!parent.written.empty()) {
+        child.written = parent.written; // what the parent wrote, the child inherits
+    }
+    child.sharedPages += shared;
+    sharing.extraMappings += shared;
+    sharing.pagesShared += shared;
+    sharing.forks++;
+}
+
+// Function: copyOnWrite
+// Purpose: A write to a shared page: the job drops its mapping and gets a
+//          private, modified copy in a frame of its own. Returns that frame.
+int copyOnWrite(Job &job, int pageNumber, int frameIndex, vector<Job> &allJobs) {
+    if (frameIndex == zeroPage.frame) {
+        zeroPage.firstWrites++; // zero-filling the new frame costs the same as a copy
+    } else {
+        sharing.cowFaults++;
+    }
+    unshareMapping(job, pageNumber, frameIndex);
+    int copy = obtainFrame(job, allJobs);
+    mapPageToFrame(job, pageNumber, copy);
+    memoryFrames[copy].modified = true;
+    dirtyFrames++;
+    pendingMigrationTime += compaction.migrateCost; // the reference waits for the copy
+    if (tlb.sets > 0) {
+        tlbAccess(tlbKey(job.jobID, pageNumber, false));
+    }
+    return copy;
+}
+
+// Function: mapZeroPage
+// Purpose: Serves a read fault on a never-written page from the shared zero frame
+void mapZeroPage(Job &job, int pageNumber) {
+    job.pageTable[pageNumber] = zeroPage.frame;
+    job.loadedPages.insert(pageNumber);
+    job.sharedPages++;
+    memoryFrames[zeroPage.frame].mapCount++;
+    sharing.extraMappings++;
+    zeroPage.faults++;
+    if (tlb.sets > 0) {
+        tlbAccess(tlbKey(job.jobID, pageNumber, false));
+    }
+}
+
+// Function: pageContent
+// Purpose: Content model: a hash of what a job's page holds
+uint64_t pageContent(const Job &job, int pageNumber) {
+    uint64_t image = job.written[pageNumber] ? (1ULL << 32) | job.jobID : (job.parentID > 0 ? job.parentID : job.jobID);
+    uint64_t key = (image << 24) ^ pageNumber;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+// Function: mergeFrames
+// Purpose: Moves every mapping of frame `from` onto frame `keep`, which holds
+//          the same contents, as shared copy-on-write mappings, and frees `from`
+void mergeFrames(int keep, int from, vector<Job> &allJobs) {
+    sharing.jobs = &allJobs;
+    Job *owner = findJob(allJobs, memoryFrames[from].jobID);
+    int page = memoryFrames[from].pageNumber;
+    auto it = sharing.mappers.find(from);
+    if (it != sharing.mappers.end()) {
+        for (auto &mapping : it->second) {
+            findJob(allJobs, mapping.first)->pageTable[mapping.second] = keep;
+            sharing.mappers[keep].push_back(mapping);
+            memoryFrames[keep].mapCount++;
+            if (tlb.sets > 0) {
+                tlbInvalidate(tlbKey(mapping.first, mapping.second, false));
+            }
+        }
+        sharing.mappers.erase(from);
+        memoryFrames[from].mapCount = 1;
+    }
+    releaseFrame(*owner, from);
+
+    owner->pageTable[page] = keep;
+    owner->loadedPages.insert(page);
+    owner->sharedPages++;
+    sharing.mappers[keep].push_back({owner->jobID, page});
+    memoryFrames[keep].mapCount++;
+    sharing.extraMappings++;
+    ksm.merges++;
+}
+
+// Function: runSamePageMerging
+// Purpose: KSM: every `interval` references, hashes the next pages in memory
+//          and merges the ones whose contents another frame already holds
+void runSamePageMerging(vector<Job> &allJobs) {
+    if (++ksm.sinceWake < ksm.interval || memoryFrames.empty()) {
+        return;
+    }
+    ksm.sinceWake = 0;
+    ksm.wakeups++;
+    int scanned = 0;
+    for (size_t visited = 0; scanned < ksm.pagesToScan && visited < memoryFrames.size(); visited++) {
+        int frameIndex = ksm.cursor;
+        if (++ksm.cursor == (int)memoryFrames.size()) {
+            ksm.cursor = 0;
+            ksm.fullScans++;
+        }
+        const PageFrame &frame = memoryFrames[frameIndex];
+        if (frame.isFree || frame.hugeHead != -1 || frame.prefetched || frame.prepaged) {
+            continue;
+        }
+        Job *owner = findJob(allJobs, frame.jobID);
+        if (owner == nullptr || owner->written.empty() || owner->written[frame.pageNumber]) {
+            continue;
+        }
+        scanned++;
+        uint64_t content = pageContent(*owner, frame.pageNumber);
+        auto it = ksm.stableTree.find(content);
+        if (it == ksm.stableTree.end() || it->second == frameIndex) {
+            ksm.stableTree[content] = frameIndex;
+            continue;
+        }
+        // The tree entry is stale if its frame has since been freed or reused
+        const PageFrame &other = memoryFrames[it->second];
+        Job *otherOwner = other.isFree ? nullptr : findJob(allJobs, other.jobID);
+        if (otherOwner == nullptr || other.hugeHead != -1 || otherOwner->written.empty() ||
+            pageContent(*otherOwner, other.pageNumber) != content) {
+            it->second = frameIndex;
+            continue;
+        }
+        mergeFrames(it->second, frameIndex, allJobs);
+    }
+    ksm.pagesScanned += scanned;
+}
+
+// Function: loadPage
+// Purpose: Loads a specific page into memory using demand paging with page replacement.
+//          A write reference also marks the page modified.
+bool loadPage(Job &job, int pageNumber, vector<Job> &allJobs, bool write = false) {
+    if (workingSetWindow > 0) {
+        updateWorkingSet(job, pageNumber);
+    }
+    // Never written before this reference: swap holds nothing for it
+    bool zeroFill = zeroPage.frame != -1 && !job.written[pageNumber];
+    if (write) {
+        STAT_INC(writeReferences);
+        if (!job.written.empty()) {
+            job.written[pageNumber] = true;
+        }
+    }
+    if (replacementPolicy == POLICY_NRU && ++referencesSinceReset >= nruResetInterval) {
+        referencesSinceReset = 0;
+        resetReferencedBits();
+    }
+    
+    // Check if page is already loaded
+    STAT_INC(pageTableProbes);
+    if (job.loadedPages.find(pageNumber) != job.loadedPages.end()) {
+        // Page hit - update access time and bits (the page table gives the frame directly)
+        STAT_INC(hits);
+        STAT_INC(pageTableProbes);
+        int frameIndex = job.pageTable[pageNumber];
+        PageFrame &frame = memoryFrames[frameIndex];
+        if (tlb.sets > 0) {
+            tlbAccess(tlbKey(job.jobID, pageNumber, frame.hugeHead != -1));
+        }
+        frame.accessTime = currentTime;
+        frame.referenced = true;
+        bool prefetchHit = frame.prefetched;
+        if (frame.prefetched) {
+            // Prefetch paid off: widen the window
+            frame.prefetched = false;
+            job.readaheadWindow = min(readaheadMax, job.readaheadWindow + 1);
+            STAT_INC(prefetchHits);
+            prefetchHitFrame = frameIndex;
+        }
+        if (frame.prepaged) {
+            frame.prepaged = false;
+            STAT_INC(prepageHits);
+        }
+        if (write && frame.mapCount > 1) {
+            copyOnWrite(job, pageNumber, frameIndex, allJobs);
+        } else if (write && !frame.modified) {
+            frame.modified = true;
+            dirtyFrames++;
+        }
+        if (prefetchHit && (prefetcher == PREFETCH_STRIDE || prefetcher == PREFETCH_MARKOV)) {
+            runPrefetcher(job, pageNumber, allJobs);
+        }
+        return true;
+    }
+
+    // Page fault occurred
+    if (zeroFill) {
+        STAT_INC(minorFaults);
+        job.minorFaults++;
+    } else {
+        STAT_INC(faults);
+        job.pageFaults++;
+    }
+    currentTime++;
+    
+    if (replacementScope == PFF_REPLACEMENT) {
+        adjustFaultFrequency(job);
+    }
+    if (zeroFill && !write) {
+        // A read needs no frame of its own either
+        mapZeroPage(job, pageNumber);
+        return true;
+    }
+    if (freeFrames.empty()) {
+        // The fault itself has to evict before its page can come in
+        STAT_INC(directReclaims);
+    }
+    
+    // Load the new page (with the rest of its region if it can be a huge page)
+    int frameIndex = (hugePages.frames > 0 && !zeroFill) ? mapHugePage(job, pageNumber, allJobs) : -1;
+    if (frameIndex == -1) {
+        frameIndex = obtainFrame(job, allJobs);
+        mapPageToFrame(job, pageNumber, frameIndex);
+    }
+    if (tlb.sets > 0) {
+        tlbAccess(tlbKey(job.jobID, pageNumber, memoryFrames[frameIndex].hugeHead != -1));
+    }
+    if (write) {
+        memoryFrames[frameIndex].modified = true;
+        dirtyFrames++;
+    }
+    if (zeroFill) {
+        // The frame is zero-filled instead of read in, at the cost of a copy
+        zeroPage.firstWrites++;
+        pendingMigrationTime += compaction.migrateCost;
+        return true;
+    }
+    
+    if (prefetcher != PREFETCH_NONE) {
+        runPrefetcher(job, pageNumber, allJobs);
+    }
+    
+    return true;
+}
+
+// Function: assignPageFrames
+// Purpose: Loads every page of a job that is not in memory yet into random free
+//          frames (OLD METHOD - NOT DEMAND PAGING), marking them loaded and
+//          linking them into the FIFO order. Loads nothing if they do not all fit.
+void assignPageFrames(Job &job){
+    // Only pages that are not already in memory need a frame
+    vector<int> missingPages;
+    for (int page : job.pages) {
+        if (job.loadedPages.find(page) == job.loadedPages.end()) {
+            missingPages.push_back(page);
+        }
+    }
+
+    // Check if memory has enough free frames for this job
+    if (missingPages.size() > freeFrames.size()) {
+        cerr << "Not enough free frames to load Job ID " << job.jobID << endl;
+        return;
+    }
+
+    for (int page: missingPages) {
+        // Pick a random free frame straight from the free list
+        int frameIndex = freeFrames[rand() % freeFrames.size()];
+        mapPageToFrame(job, page, frameIndex);
+    }
+}
+
+// Job list array
+// List of jobs
+
+// Need to simulate the JT, PMT, MMT
+/* 
+    Job Table:
+    - Job ID
+    - Job Size
+    - No. of Pages    
+    - Pages Loaded
+    - Page Faults
+
+    Page Map Table:
+    - Page Number
+    - Frame Number
+    - Loaded Status
+    - Modified/Referenced bits
+
+    Memory Map Table:
+    - frame number
+    - availability or status (free or occupied)
+    - job id (if occupied)
+    - page number (if occupied)
+    - access time
+*/
+void displayTables(const vector<Job> &jobs) {
+    cout << "\n--- Job Table ---\n";
+    cout << left << setw(8) << "Job ID" << setw(12) << "Job Size" << setw(14) << "No. of Pages" << setw(16) << "Pages Loaded" << setw(12) << "Page Faults" << setw(24) << "Internal Fragmentation" << "\n";
+    for (const auto &job : jobs) {
+        cout << left << setw(8) << job.jobID << setw(12) << job.jobSize
+                << setw(14) << job.pages.size() << setw(16) << job.loadedPages.size() 
+                << setw(12) << job.pageFaults << setw(24) << job.internalFragmentation << "\n";
+    }
+
+    cout << "\n--- Page Map Table ---\n";
+    cout << left << setw(8) << "Job ID" << setw(14) << "Page Number" << setw(14) << "Frame Number" << setw(12) << "Status" << "\n";
+    for (const auto &job : jobs) {
+        for (const auto &page : job.pages) {
+            cout << left << setw(8) << job.jobID << setw(14) << page;
+            if (job.loadedPages.find(page) != job.loadedPages.end()) {
+                cout << setw(14) << job.pageTable.at(page) << setw(12) << "Loaded" << "\n";
+            } else {
+                cout << setw(14) << "-" << setw(12) << "Not Loaded" << "\n";
+            }
+        }
+    }
+
+    cout << "\n--- Memory Map Table ---\n";
+    cout << left << setw(14) << "Frame Number" << setw(14) << "Status" << setw(14) << "Job ID" << setw(14) << "Page Number" << setw(6) << "R/M" << "\n";
+    for (const auto &frame : memoryFrames) {
+        cout << left << setw(14) << frame.frameID;
+        if (frame.isFree) {
+            cout << setw(14) << "Free" << setw(14) << "-" << setw(14) << "-" << setw(6) << "-" << "\n";
+        } else {
+            cout << setw(14) << "Occupied" << setw(14) << frame.jobID << setw(14) << frame.pageNumber
+                 << frame.referenced << "/" << frame.modified << "\n";
+        }
+    }
+    cout << endl;
+}
+
+
+// Import jobs from a csv file to populate into the job list
+vector<Job> importJobsFromFile(string filename, int pagesize) {
+    vector<Job> jobs;
+    ifstream file(filename);
+    string line;
+
+    if (!file.is_open()) {
+        cerr << "Error opening file: " << filename << endl;
+        return jobs;
+    }
+
+    while (getline(file, line)) {
+        // Skip empty lines
+        if (line.empty()) {
+            continue;
+        }
+        
+        stringstream ss(line);
+        string token;
+        Job job;
+
+        // CSV format: jobID, jobSize
+        getline(ss, token, ',');
+        if (token.empty()) {
+            continue; // Skip if jobID is empty
+        }
+        try {
+            job.jobID = stoi(token);
+            if (job.jobID < 0 || job.jobID >= MAX_JOB_ID) {
+                cerr << "Skipping job with out of range ID: " << job.jobID << endl;
+                continue;
+            }
+
+            getline(ss, token, ',');
+            if (token.empty()) {
+                continue; // Skip if jobSize is empty
+            }
+            job.jobSize = stoi(token);
+            job.pageSize = pagesize;
+
+            // Optional columns: arrivalTime, runTime (used by Program 1), priority
+            for (int column = 3; getline(ss, token, ','); column++) {
+                if (column == 5 && !token.empty()) {
+                    job.priority = stoi(token);
+                }
+            }
+        } catch (const logic_error &) {
+            cerr << "Skipping malformed line: " << line << endl;
+            continue;
+        }
+
+        divideJobIntoPages(job);
+        jobs.push_back(job);
+    }
+
+    file.close();
+    buildJobIndex(jobs);
+    return jobs;
+}   
+
+// Address resolution function with demand paging
+// Resolve logical address based on user input
+void resolveAddress(Job &job, int logicalAddress, vector<Job> &allJobs) {
+    int pageNumber = logicalAddress / job.pageSize;
+    int offset = logicalAddress % job.pageSize;
+
+    if (pageNumber >= job.pages.size()) {
+        cout << "Logical address out of bounds for Job ID " << job.jobID << endl;
+        return;
+    }
+
+    // Check if page is loaded, if not, load it using demand paging
+    if (job.loadedPages.find(pageNumber) == job.loadedPages.end()) {
+        cout << "Page " << pageNumber << " not in memory. Loading page on demand...\n";
+        loadPage(job, pageNumber, allJobs);
+    }
+
+    int frameNumber = job.pageTable[pageNumber];
+    int physicalAddress = frameNumber * job.pageSize + offset;
+
+    cout << "Logical Address: " << logicalAddress << " -> Physical Address: " << physicalAddress
+        << " (Frame: " << frameNumber << ", Offset: " << offset << ")\n";
+    cout << "Page Faults for Job " << job.jobID << ": " << job.pageFaults << "\n";
+}
+
+// Function to preview jobs from CSV
+void previewJobs(const vector<Job> &jobs) {
+    cout << "\nJobs Loaded from CSV:\n";
+    cout << left << setw(8) << "Job ID" << setw(12) << "Job Size" << setw(14) << "Pages" << setw(20) << "Fragmentation" << "\n";
+    for (auto &job : jobs) {
+        cout << left << setw(8) << job.jobID << setw(12) << job.jobSize 
+                << setw(14) << job.pages.size() << setw(20) << job.internalFragmentation << "\n";
+    }
+}
+
+// Function to show empty memory map
+void showEmptyMemory() {
+    cout << "\nInitial Memory State (All Free):\n";
+    for (auto &frame : memoryFrames) {
+        cout << "Frame " << frame.frameID << " | Free\n";
+    }
+}
+
+// Function to simulate allocation with delay
+void simulateAllocation(vector<Job> &jobs) {
+    cout << "\nSimulating page allocation...\n";
+    for (auto &job : jobs) {
+        cout << "Allocating Job " << job.jobID << "...\n";
+        assignPageFrames(job);
+        this_thread::sleep_for(chrono::milliseconds(700));
+    }
+    cout << "Allocation complete.\n";
+}
+
+/*
+    COMPRESSED REFERENCE TRACE FORMAT (.dpt)
+    Raw traces are far too big to keep as text, so references are stored compactly:
+    - each record is (job ID, logical address, read/write), address -1 means the job exits
+    - an address is stored as the delta from the previous address of the same job
+    - deltas are zigzag encoded (small negatives -> small positives), shifted left
+      to carry the write flag in the low bit (version 2), and written as varints
+      (version 1 traces have no flag and are all reads)
+    - records are grouped into blocks, per-job deltas restart in every block
+      so any block can be decoded on its own
+    - an index of block offsets sits at the end of the file so a reader
+      can seek straight to any record
+
+    File layout (integers are little-endian):
+    - header : "DPTR" | u32 version
+    - blocks : u32 recordCount | u32 payloadBytes | payload
+    - index  : per block { u64 fileOffset | u64 firstRecord }
+    - footer : u64 indexOffset | u64 blockCount | u64 totalRecords | "DPTI"
+*/
+const char TRACE_MAGIC[4] = {'D', 'P', 'T', 'R'};
+const char TRACE_INDEX_MAGIC[4] = {'D', 'P', 'T', 'I'};
+const uint32_t TRACE_VERSION = 2;
+const uint32_t TRACE_BLOCK_RECORDS = 65536; // records per block
+const size_t TRACE_QUEUE_BLOCKS = 8; // decoded blocks buffered ahead of the engine
+const int TRACE_FOOTER_BYTES = 28;
+
+struct TraceRecord {
+    int jobID;
+    int logicalAddress; // TRACE_EXIT_ADDRESS marks the job terminating
+    bool write = false; // a store: marks the page modified
+};
+
+const int TRACE_EXIT_ADDRESS = -1;
+
+struct TraceBlockInfo {
+    uint64_t fileOffset; // where the block header starts
+    uint64_t firstRecord; // index of the first record in the block
+};
+
+// zigzag maps signed values to unsigned so small negative deltas stay short
+uint64_t zigzagEncode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// varint: 7 bits per byte, high bit set while more bytes follow
+void putVarint(vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// Returns false if the varint runs past the end of the buffer
+bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeU32(ostream &out, uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; i++) bytes[i] = (char)(value >> (8 * i));
+    out.write(bytes, 4);
+}
+
+void writeU64(ostream &out, uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = (char)(value >> (8 * i));
+    out.write(bytes, 8);
+}
+
+bool readU32(istream &in, uint32_t &value) {
+    unsigned char bytes[4];
+    if (!in.read((char *)bytes, 4)) return false;
+    value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)bytes[i] << (8 * i);
+    return true;
+}
+
+bool readU64(istream &in, uint64_t &value) {
+    unsigned char bytes[8];
+    if (!in.read((char *)bytes, 8)) return false;
+    value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)bytes[i] << (8 * i);
+    return true;
+}
+
+/*
+    TRACE WRITER
+    Buffers one block of encoded records and flushes it when full.
+    The block index is kept in memory and written out on close.
+*/
+struct TraceWriter {
+    ofstream file;
+    vector<uint8_t> payload; // encoded records of the current block
+    unordered_map<int, int> lastAddress; // per-job previous address (reset every block)
+    vector<TraceBlockInfo> index;
+    uint32_t blockRecords = 0;
+    uint64_t totalRecords = 0;
+};
+
+bool openTraceWriter(TraceWriter &writer, const string &filename) {
+    writer.file.open(filename, ios::binary | ios::trunc);
+    if (!writer.file.is_open()) {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+    writer.file.write(TRACE_MAGIC, 4);
+    writeU32(writer.file, TRACE_VERSION);
+    writer.payload.reserve(TRACE_BLOCK_RECORDS * 4);
+    return true;
+}
+
+// Function: flushTraceBlock
+// Purpose: Writes the buffered block and records it in the index
+void flushTraceBlock(TraceWriter &writer) {
+    if (writer.blockRecords == 0) {
+        return;
+    }
+    writer.index.push_back({(uint64_t)writer.file.tellp(), writer.totalRecords - writer.blockRecords});
+    writeU32(writer.file, writer.blockRecords);
+    writeU32(writer.file, (uint32_t)writer.payload.size());
+    writer.file.write((const char *)writer.payload.data(), writer.payload.size());
+
+    writer.payload.clear();
+    writer.lastAddress.clear();
+    writer.blockRecords = 0;
+}
+
+void appendTraceRecord(TraceWriter &writer, int jobID, int logicalAddress, bool write = false) {
+    auto inserted = writer.lastAddress.insert({jobID, 0});
+    int64_t delta = (int64_t)logicalAddress - inserted.first->second;
+    inserted.first->second = logicalAddress;
+
+    putVarint(writer.payload, zigzagEncode(jobID));
+    putVarint(writer.payload, zigzagEncode(delta) << 1 | write);
+    writer.blockRecords++;
+    writer.totalRecords++;
+
+    if (writer.blockRecords == TRACE_BLOCK_RECORDS) {
+        flushTraceBlock(writer);
+    }
+}
+
+// Function: closeTraceWriter
+// Purpose: Flushes the last block, then writes the block index and footer
+bool closeTraceWriter(TraceWriter &writer) {
+    flushTraceBlock(writer);
+    uint64_t indexOffset = (uint64_t)writer.file.tellp();
+    for (const auto &block : writer.index) {
+        writeU64(writer.file, block.fileOffset);
+        writeU64(writer.file, block.firstRecord);
+    }
+    writeU64(writer.file, indexOffset);
+    writeU64(writer.file, writer.index.size());
+    writeU64(writer.file, writer.totalRecords);
+    writer.file.write(TRACE_INDEX_MAGIC, 4);
+
+    bool ok = writer.file.good();
+    writer.file.close();
+    return ok;
+}
+
+// Function: decodeTraceBlock
+// Purpose: Decodes one block payload back into records, false if the block is corrupt
+bool decodeTraceBlock(const vector<uint8_t> &payload, uint32_t recordCount, vector<TraceRecord> &records,
+                      uint32_t version) {
+    unordered_map<int, int> lastAddress;
+    const uint8_t *p = payload.data();
+    const uint8_t *end = p + payload.size();
+
+    records.clear();
+    records.reserve(recordCount);
+    for (uint32_t i = 0; i < recordCount; i++) {
+        uint64_t jobID, delta;
+        if (!getVarint(p, end, jobID) || !getVarint(p, end, delta)) {
+            return false;
+        }
+        TraceRecord record;
+        if (version >= 2) {
+            record.write = delta & 1;
+            delta >>= 1;
+        }
+        record.jobID = (int)zigzagDecode(jobID);
+        int &previous = lastAddress[record.jobID];
+        record.logicalAddress = (int)(previous + zigzagDecode(delta));
+        previous = record.logicalAddress;
+        records.push_back(record);
+    }
+    return p == end;
+}
+
+/*
+    STREAMING TRACE DECODER
+    A worker thread reads and decodes blocks while the paging engine
+    consumes earlier ones. The two sides meet at a bounded buffer of
+    TRACE_QUEUE_BLOCKS decoded blocks, so memory stays flat no matter
+    how large the trace is.
+*/
+struct TraceDecoder {
+    ifstream file;
+    vector<TraceBlockInfo> index;
+    uint64_t totalRecords = 0;
+    uint64_t fileSize = 0; // bounds the sizes read from the file before anything is allocated
+    uint32_t version = TRACE_VERSION;
+    size_t firstBlock = 0; // block the worker starts at
+    uint64_t skipRecords = 0; // records dropped from the first block after a seek
+
+    thread worker;
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+    deque<vector<TraceRecord>> ready;
+    bool finished = false; // worker reached the end (or hit an error)
+    bool stopRequested = false;
+    bool corrupt = false;
+};
+
+// Function: openTraceDecoder
+// Purpose: Validates the file, loads the block index and seeks to startRecord
+bool openTraceDecoder(TraceDecoder &decoder, const string &filename, uint64_t startRecord) {
+    decoder.file.open(filename, ios::binary);
+    if (!decoder.file.is_open()) {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+
+    char magic[4];
+    uint32_t &version = decoder.version;
+    if (!decoder.file.read(magic, 4) || !equal(magic, magic + 4, TRACE_MAGIC) ||
+        !readU32(decoder.file, version) || version < 1 || version > TRACE_VERSION) {
+        cerr << "Not a compressed trace file: " << filename << endl;
+        return false;
+    }
+
+    decoder.file.seekg(0, ios::end);
+    decoder.fileSize = (uint64_t)decoder.file.tellg();
+    uint64_t indexOffset, blockCount;
+    decoder.file.seekg(-TRACE_FOOTER_BYTES, ios::end);
+    if (!readU64(decoder.file, indexOffset) || !readU64(decoder.file, blockCount) ||
+        !readU64(decoder.file, decoder.totalRecords) || !decoder.file.read(magic, 4) ||
+        !equal(magic, magic + 4, TRACE_INDEX_MAGIC)) {
+        cerr << "Trace file is truncated (missing index): " << filename << endl;
+        return false;
+    }
+
+    // Each index entry is 16 bytes between indexOffset and the footer
+    uint64_t indexEnd = decoder.fileSize - TRACE_FOOTER_BYTES;
+    if (indexOffset > indexEnd || blockCount > (indexEnd - indexOffset) / 16) {
+        cerr << "Trace index is corrupt: " << filename << endl;
+        return false;
+    }
+    decoder.file.seekg(indexOffset);
+    decoder.index.resize(blockCount);
+    for (auto &block : decoder.index) {
+        if (!readU64(decoder.file, block.fileOffset) || !readU64(decoder.file, block.firstRecord)) {
+            cerr << "Trace index is corrupt: " << filename << endl;
+            return false;
+        }
+    }
+
+    // Seek: last block whose first record is <= startRecord
+    auto it = upper_bound(decoder.index.begin(), decoder.index.end(), startRecord,
+                          [](uint64_t record, const TraceBlockInfo &block) { return record < block.firstRecord; });
+    decoder.firstBlock = (it == decoder.index.begin()) ? 0 : (it - decoder.index.begin()) - 1;
+    if (startRecord >= decoder.totalRecords) {
+        decoder.firstBlock = decoder.index.size();
+    } else {
+        decoder.skipRecords = startRecord - decoder.index[decoder.firstBlock].firstRecord;
+    }
+    return true;
+}
+
+void traceDecoderWorker(TraceDecoder *decoder) {
+    vector<uint8_t> payload;
+    for (size_t b = decoder->firstBlock; b < decoder->index.size(); b++) {
+        uint32_t recordCount, payloadBytes;
+        decoder->file.seekg(decoder->index[b].fileOffset);
+        bool ok = readU32(decoder->file, recordCount) && readU32(decoder->file, payloadBytes);
+        // A record is at least 2 bytes, and the payload has to fit in the file
+        uint64_t offset = decoder->index[b].fileOffset;
+        ok = ok && offset + 8 <= decoder->fileSize && payloadBytes <= decoder->fileSize - offset - 8 &&
+             recordCount <= payloadBytes / 2;
+        if (ok) {
+            payload.resize(payloadBytes);
+            ok = (bool)decoder->file.read((char *)payload.data(), payloadBytes);
+        }
+
+        vector<TraceRecord> records;
+        if (!ok || !decodeTraceBlock(payload, recordCount, records, decoder->version)) {
+            lock_guard<mutex> guard(decoder->lock);
+            decoder->corrupt = true;
+            break;
+        }
+        if (b == decoder->firstBlock && decoder->skipRecords > 0) {
+            records.erase(records.begin(), records.begin() + min<uint64_t>(decoder->skipRecords, records.size()));
+        }
+
+        unique_lock<mutex> guard(decoder->lock);
+        decoder->notFull.wait(guard, [decoder] { return decoder->ready.size() < TRACE_QUEUE_BLOCKS || decoder->stopRequested; });
+        if (decoder->stopRequested) {
+            break;
+        }
+        decoder->ready.push_back(move(records));
+        decoder->notEmpty.notify_one();
+    }
+
+    lock_guard<mutex> guard(decoder->lock);
+    decoder->finished = true;
+    decoder->notEmpty.notify_one();
+}
+
+void startTraceDecoder(TraceDecoder &decoder) {
+    decoder.worker = thread(traceDecoderWorker, &decoder);
+}
+
+// Function: nextTraceBlock
+// Purpose: Blocks until the worker has a decoded block ready, false at end of trace
+bool nextTraceBlock(TraceDecoder &decoder, vector<TraceRecord> &records) {
+    unique_lock<mutex> guard(decoder.lock);
+    decoder.notEmpty.wait(guard, [&decoder] { return !decoder.ready.empty() || decoder.finished; });
+    if (decoder.ready.empty()) {
+        return false;
+    }
+    records = move(decoder.ready.front());
+    decoder.ready.pop_front();
+    decoder.notFull.notify_one();
+    return true;
+}
+
+void closeTraceDecoder(TraceDecoder &decoder) {
+    {
+        lock_guard<mutex> guard(decoder.lock);
+        decoder.stopRequested = true;
+        decoder.notFull.notify_one();
+    }
+    if (decoder.worker.joinable()) {
+        decoder.worker.join();
+    }
+    decoder.file.close();
+}
+
+// Function: encodeTraceFromCSV
+// Purpose: Converts a text trace (jobID,logicalAddress[,R|W] per line) into the compressed format
+bool encodeTraceFromCSV(const string &csvFile, const string &traceFile) {
+    ifstream in(csvFile);
+    if (!in.is_open()) {
+        cerr << "Error opening file: " << csvFile << endl;
+        return false;
+    }
+    TraceWriter writer;
+    if (!openTraceWriter(writer, traceFile)) {
+        return false;
+    }
+
+    string line;
+    uint64_t textBytes = 0;
+    uint64_t malformed = 0;
+    while (getline(in, line)) {
+        textBytes += line.size() + 1;
+        if (line.empty()) {
+            continue;
+        }
+        stringstream ss(line);
+        string jobToken, addressToken, accessToken;
+        getline(ss, jobToken, ',');
+        getline(ss, addressToken, ',');
+        getline(ss, accessToken, ',');
+        int jobID, logicalAddress;
+        try {
+            jobID = stoi(jobToken);
+            logicalAddress = stoi(addressToken);
+        } catch (const logic_error &) {
+            malformed++; // missing or non-numeric field: skip the line
+            continue;
+        }
+        bool write = !accessToken.empty() && (accessToken[0] == 'W' || accessToken[0] == 'w' || accessToken[0] == '1');
+        appendTraceRecord(writer, jobID, logicalAddress, write);
+    }
+    if (malformed > 0) {
+        cerr << "Skipped " << malformed << " malformed lines in " << csvFile << endl;
+    }
+
+    uint64_t records = writer.totalRecords;
+    if (!closeTraceWriter(writer)) {
+        cerr << "Error writing file: " << traceFile << endl;
+        return false;
+    }
+
+    ifstream out(traceFile, ios::binary | ios::ate);
+    uint64_t traceBytes = (uint64_t)out.tellg();
+    cout << "Encoded " << records << " references: " << textBytes << " bytes -> " << traceBytes << " bytes";
+    if (traceBytes > 0) {
+        cout << " (" << fixed << setprecision(2) << (double)textBytes / traceBytes << "x)";
+    }
+    cout << "\n";
+    return true;
+}
+
+// Function: showTraceInfo
+// Purpose: Prints the header/index summary of a compressed trace; false if it cannot be opened
+bool showTraceInfo(const string &traceFile) {
+    TraceDecoder decoder;
+    if (!openTraceDecoder(decoder, traceFile, 0)) {
+        return false;
+    }
+    decoder.file.seekg(0, ios::end);
+    uint64_t fileBytes = (uint64_t)decoder.file.tellg();
+
+    cout << "Trace File : " << traceFile << "\n";
+    cout << "Version    : " << decoder.version << "\n";
+    cout << "References : " << decoder.totalRecords << "\n";
+    cout << "Blocks     : " << decoder.index.size() << "\n";
+    cout << "File Size  : " << fileBytes << " bytes\n";
+    if (decoder.totalRecords > 0) {
+        cout << "Bytes/Ref  : " << fixed << setprecision(2) << (double)fileBytes / decoder.totalRecords << "\n";
+    }
+    return true;
+}
+
+// Function: dumpTrace
+// Purpose: Decodes a slice of a compressed trace back to text (jobID,logicalAddress, plus ",W" on writes);
+//          false if it cannot be opened
+bool dumpTrace(const string &traceFile, uint64_t startRecord, uint64_t maxRecords) {
+    TraceDecoder decoder;
+    if (!openTraceDecoder(decoder, traceFile, startRecord)) {
+        return false;
+    }
+    startTraceDecoder(decoder);
+    uint64_t written = 0;
+    vector<TraceRecord> block;
+    while (written < maxRecords && nextTraceBlock(decoder, block)) {
+        for (size_t i = 0; i < block.size() && written < maxRecords; i++, written++) {
+            cout << block[i].jobID << "," << block[i].logicalAddress << (block[i].write ? ",W\n" : "\n");
+        }
+    }
+    closeTraceDecoder(decoder);
+    return true;
+}
+
+/*
+    Simulation options (command line)
+    - jobs file and memory geometry used to build the engine
+    - which slice of the trace to run
+    - synthetic workload settings for "generate"
+*/
+struct SimOptions {
+    string jobsFile = "jobs.csv";
+    int jobScale = 1; // multiplies every job size from the jobs file
+    int numFrames = 10;
+    int pageSize = 512;
+    uint64_t startRecord = 0;
+    uint64_t maxRecords = UINT64_MAX;
+
+    string pattern = "mixed";
+    string outFile; // generate: write a .dpt trace
+    bool replay = false; // generate: feed references straight into the engine
+    uint64_t seed = 1;
+    double zipfTheta = 0.99;
+    int burst = 16; // references a job issues before the next job runs
+    int phaseLength = 10000; // references per working-set phase
+    int workingSetPages = 0; // 0 = job pages / 8
+    int loopPages = 0; // 0 = job pages / 4
+    int stridePages = 16; // distance between references of the stride pattern
+    uint64_t churnLength = 0; // references per job lifetime before it exits (0 = never)
+
+    double writeRatio = 0; // generate: fraction of references that are writes
+    string policy = "fifo"; // global victim selection
+    int nruInterval = 10000; // references between NRU referenced-bit resets
+    string scope = "global"; // replacement scope
+    string quota = "equal"; // quota policy for local replacement
+    double pffUpper = 0.05; // PFF fault-rate thresholds (faults per reference)
+    double pffLower = 0.005;
+    int workingSetWindow = 0; // delta for W(t, delta); 0 = not tracked
+    uint64_t workingSetSample = 100000; // references between working set samples
+    string workingSetOut; // CSV file for the working set time series
+
+    int swapReadLatency = 1000; // time units before a page-in starts transferring (a hit costs 1)
+    int swapWriteLatency = 1000;
+    double swapBandwidth = 0; // bytes per time unit (0 = transfers take no time)
+    int swapQueueDepth = 0; // requests the device serves at once (0 = unlimited)
+    bool flusher = false; // background write-back of dirty pages
+    double flushThreshold = 0.1;
+    int flushBatch = 64;
+    int flushInterval = 2000;
+    bool reclaimer = false; // kswapd-style background reclaim
+    double lowWatermark = 0.02; // fraction of frames free that wakes the reclaimer
+    double highWatermark = 0.05; // fraction free it reclaims up to
+    bool loadControl = false;
+    int loadWindow = 10000; // references per thrashing check
+    double loadHigh = 0.1; // global fault rate that counts as thrashing
+    double loadLow = 0.02; // fault rate low enough to resume a job
+
+    string compareWith; // compare: the setting the runs differ in
+    int quantum = 100; // schedule: references per CPU time slice
+    int maxMultiprogramming = 0; // schedule: largest degree of multiprogramming (0 = every job)
+    string prefetcher = "none"; // none, readahead, stride or markov
+    int readaheadMin = 2; // smallest prefetch window in pages
+    int readaheadMax = 64; // largest prefetch window in pages
+    int markovEntries = 65536; // Markov prefetcher table size
+    int prepage = 0; // pages to load when a job is admitted (0 = off)
+    bool prepageResume = false; // restore a resumed job's saved working set
+    int startupWindow = 1000; // references after admission or resume counted as startup
+    int hugePageFrames = 0; // base pages per huge page (0 = off)
+    int hugeMinPages = 0; // smallest job that gets huge pages
+    int tlbEntries = 0; // TLB model size (0 = off)
+    double tlbMissCost = 0.5; // time units per TLB miss (page walk)
+    bool compaction = false; // direct compaction on huge page faults
+    int migrateCost = 10; // time units to copy a page
+    bool khugepaged = false; // background promotion to huge pages
+    int khugepagedInterval = 10000;
+    int khugepagedScan = 64;
+    int forkChildren = 0; // forked copies of every job (0 = none)
+    uint64_t forkAfter = 10000; // generate: parent references before its children are forked
+    bool ksm = false; // same-page merging scanner
+    int ksmInterval = 1000;
+    int ksmPages = 100;
+    int ksmScanCost = 2; // time units to hash one page
+    bool zeroPage = false; // map read faults on never-written pages to a shared zero frame
+};
+
+/*
+    SWAP DEVICE
+    The backing store that faults read pages from. A request:
+    1. waits for one of the queueDepth channels (FIFO)
+    2. spends the read or write latency on that channel; latencies on
+       different channels overlap
+    3. transfers the page over the device's one bus at `bandwidth`
+    and completes when the transfer ends. Requests from different jobs are
+    in flight together, so with the CPU scheduler their waits overlap.
+    Trace replay has no other job to run, so there each fault waits for its
+    own request to complete before the next reference.
+    Time is in the same units as a reference (a page hit costs 1).
+*/
+enum SwapOperation { SWAP_READ, SWAP_WRITE };
+
+struct SwapDevice {
+    int readLatency = 1000;
+    int writeLatency = 1000;
+    double bandwidth = 0; // bytes per time unit, 0 = unlimited
+    int queueDepth = 0; // 0 = unlimited
+    priority_queue<uint64_t, vector<uint64_t>, greater<uint64_t>> channelFree; // when each busy channel frees up
+    uint64_t busFree = 0; // when the bus finishes its last transfer
+    uint64_t busyUntil = 0; // end of the last request, for utilization
+    uint64_t busyTime = 0; // time with at least one request in service
+    uint64_t reads = 0; // requests
+    uint64_t writes = 0;
+    uint64_t pagesWritten = 0; // a coalesced write carries several pages
+    uint64_t queueWait = 0; // time spent waiting for a channel
+    uint64_t serviceTime = 0; // submission to completion, summed
+};
+
+SwapDevice swapDevice;
+
+/*
+    BACKGROUND FLUSHER
+    Cleans dirty pages before they are chosen as victims, so a fault rarely
+    has to wait for a write-back. It wakes every `interval` time units and,
+    when more than `threshold` of the frames are dirty and memory is too
+    full for the oldest pages to last (fewer free frames than a batch), it
+    looks at the `batch` oldest pages in the replacement order (the next
+    victims) and writes out the dirty ones; pages further back may still be
+    written again before they are evicted, so they are left alone. Each
+    job's pages live in consecutive swap slots, so the batch is sorted by
+    job and page and runs of adjacent pages go out as one I/O of up to
+    maxRun pages.
+    The writes run in the background; nothing waits for them.
+*/
+struct Flusher {
+    bool enabled = false;
+    double threshold = 0.1; // fraction of frames dirty before it runs
+    int batch = 64; // pages per pass
+    int maxRun = 32; // pages coalesced into one I/O
+    int interval = 2000; // time units between wake-ups
+    uint64_t nextWake = 0;
+    uint64_t passes = 0;
+    uint64_t pagesCleaned = 0;
+    uint64_t writes = 0; // I/Os issued
+};
+
+Flusher flusher;
+
+// Function: initHugePages
+// Purpose: Sets up huge pages and the TLB model on freshly initialized frames
+void initHugePages(const SimOptions &options) {
+    hugePages = HugePageState();
+    hugePages.frames = options.hugePageFrames;
+    hugePages.minPages = options.hugeMinPages;
+    while ((1 << hugePages.order) < hugePages.frames) {
+        hugePages.order++;
+    }
+    pendingHugeRead = 0;
+
+    compaction = Compaction();
+    compaction.enabled = options.compaction;
+    compaction.migrateCost = options.migrateCost;
+    pendingMigrationTime = 0;
+    promoter = Promoter();
+    promoter.enabled = options.khugepaged;
+    promoter.interval = options.khugepagedInterval;
+    promoter.scanRegions = options.khugepagedScan;
+
+    tlb = TLB();
+    tlbMissCost = options.tlbMissCost;
+    tlb.sets = (options.tlbEntries + tlb.ways - 1) / tlb.ways;
+    tlb.keys.assign(tlb.sets * tlb.ways, TLB_EMPTY);
+    tlb.lastUse.assign(tlb.sets * tlb.ways, 0);
+}
+
+// Function: initPrefetcher
+// Purpose: Selects the prefetcher and forgets everything a previous run taught
+//          it or left pending (the per-job detectors live in the jobs)
+void initPrefetcher(const SimOptions &options) {
+    prefetcher = (PrefetcherKind)(find(begin(PREFETCHER_NAMES), end(PREFETCHER_NAMES), options.prefetcher) - begin(PREFETCHER_NAMES));
+    readaheadMin = options.readaheadMin;
+    readaheadMax = options.readaheadMax;
+    pendingPrepage = 0;
+    pendingReadahead = 0;
+    pendingPrefetchFrames.clear();
+    prefetchHitFrame = -1;
+    pinnedFrame = -1;
+    markovTable.assign(prefetcher == PREFETCH_MARKOV ? options.markovEntries : 0, MarkovEntry());
+}
+
+// Function: initSamePageMerging
+// Purpose: Sets up the KSM scanner with an empty stable tree, and reserves
+//          the zero frame (the last frame) on freshly initialized frames
+void initSamePageMerging(const SimOptions &options) {
+    ksm = SamePageMerging();
+    ksm.enabled = options.ksm;
+    ksm.interval = options.ksmInterval;
+    ksm.pagesToScan = options.ksmPages;
+    ksm.scanCost = options.ksmScanCost;
+
+    zeroPage = ZeroPage();
+    if (options.zeroPage && !memoryFrames.empty()) {
+        zeroPage.frame = memoryFrames.size() - 1;
+        takeFreeFrame(zeroPage.frame);
+        memoryFrames[zeroPage.frame].isFree = false;
+        memoryFrames[zeroPage.frame].mapCount = 1;
+    }
+}
+
+// Function: initSwapDevice
+// Purpose: An idle device with the configured latencies, bandwidth and depth
+void initSwapDevice(const SimOptions &options) {
+    swapDevice = SwapDevice();
+    swapDevice.readLatency = options.swapReadLatency;
+    swapDevice.writeLatency = options.swapWriteLatency;
+    swapDevice.bandwidth = options.swapBandwidth;
+    swapDevice.queueDepth = options.swapQueueDepth;
+    flusher = Flusher();
+    flusher.enabled = options.flusher;
+    flusher.threshold = options.flushThreshold;
+    flusher.batch = options.flushBatch;
+    flusher.interval = options.flushInterval;
+}
+
+// Function: submitSwapRequest
+// Purpose: Queues a transfer of `pages` contiguous swap slots at time `now` and
+//          returns when it completes. Requests must be submitted in time order.
+uint64_t submitSwapRequest(SwapDevice &device, uint64_t now, SwapOperation operation, int pages = 1) {
+    uint64_t start = now;
+    if (device.queueDepth > 0 && (int)device.channelFree.size() == device.queueDepth) {
+        start = max(now, device.channelFree.top());
+        device.channelFree.pop();
+    }
+    uint64_t transferStart = start + (operation == SWAP_READ ? device.readLatency : device.writeLatency);
+    uint64_t finish = transferStart;
+    if (device.bandwidth > 0) {
+        transferStart = max(transferStart, device.busFree);
+        finish = transferStart + (uint64_t)ceil((double)pages * memoryFrames[0].frameSize / device.bandwidth);
+        device.busFree = finish;
+    }
+    if (device.queueDepth > 0) {
+        device.channelFree.push(finish);
+    }
+
+    device.busyTime += finish - min(finish, max(start, device.busyUntil));
+    device.busyUntil = max(device.busyUntil, finish);
+    device.queueWait += start - now;
+    device.serviceTime += finish - now;
+    if (operation == SWAP_READ) {
+        device.reads++;
+    } else {
+        device.writes++;
+        device.pagesWritten += pages;
+    }
+    return finish;
+}
+
+// Function: flushDirtyPages
+// Purpose: One flusher pass at time `now`
+void flushDirtyPages(uint64_t now) {
+    vector<pair<pair<int, int>, int>> dirty; // ((jobID, page), frame)
+    int scanned = 0;
+    for (int frameIndex = replacementHead; frameIndex != -1 && scanned < flusher.batch;
+         frameIndex = memoryFrames[frameIndex].nextFrame, scanned++) {
+        const PageFrame &frame = memoryFrames[frameIndex];
+        if (frame.modified) {
+            dirty.push_back({{frame.jobID, frame.pageNumber}, frameIndex});
+        }
+    }
+    if (dirty.empty()) {
+        return;
+    }
+    sort(dirty.begin(), dirty.end());
+
+    for (size_t start = 0; start < dirty.size();) {
+        size_t end = start + 1;
+        while (end < dirty.size() && (int)(end - start) < flusher.maxRun &&
+               dirty[end].first.first == dirty[start].first.first &&
+               dirty[end].first.second == dirty[end - 1].first.second + 1) {
+            end++;
+        }
+        submitSwapRequest(swapDevice, now, SWAP_WRITE, end - start);
+        flusher.writes++;
+        for (size_t i = start; i < end; i++) {
+            memoryFrames[dirty[i].second].modified = false;
+        }
+        dirtyFrames -= end - start;
+        flusher.pagesCleaned += end - start;
+        start = end;
+    }
+    flusher.passes++;
+}
+
+/*
+    BACKGROUND RECLAIMER (kswapd)
+    Keeps a pool of free frames so demand faults take the fast findFreeFrame
+    path instead of choosing and evicting a victim inline. When a reference
+    leaves fewer than lowWatermark frames free, the reclaimer wakes and evicts
+    victims until highWatermark frames are free: the replacement policy's
+    victim under global scope, otherwise the oldest page of the job holding
+    the most frames over its quota (local, pff, ws).
+    It runs between references, off the fault path, and the write-backs of
+    dirty pages it evicts go to the swap device in the background.
+    Higher watermarks mean fewer direct reclaims but more memory held empty.
+*/
+struct Reclaimer {
+    bool enabled = false;
+    int lowFrames = 0;
+    int highFrames = 0;
+};
+
+Reclaimer reclaimer;
+
+// Function: initReclaimer
+// Purpose: Converts the watermark fractions into frame counts for the current memory
+void initReclaimer(const SimOptions &options) {
+    reclaimer = Reclaimer();
+    reclaimer.enabled = options.reclaimer;
+    int frames = memoryFrames.size();
+    reclaimer.lowFrames = max(1, (int)ceil(options.lowWatermark * frames));
+    reclaimer.highFrames = min(frames - 1, max(reclaimer.lowFrames, (int)ceil(options.highWatermark * frames)));
+    // Too little memory to keep any frame free: it never wakes
+    reclaimer.lowFrames = min(reclaimer.lowFrames, reclaimer.highFrames);
+}
+
+// Function: chooseReclaimVictim
+// Purpose: The frame the reclaimer evicts next, or -1 if nothing is resident.
+//          Non-global scopes take the oldest page of the job furthest over
+//          its quota (a job without a quota counts all its frames).
+int chooseReclaimVictim(vector<Job> &jobs) {
+    if (replacementScope == GLOBAL_REPLACEMENT) {
+        return replacementHead != -1 ? chooseVictim() : -1;
+    }
+    Job *victim = nullptr;
+    int victimExcess = 0;
+    for (auto &job : jobs) {
+        if (job.residentTail == -1) {
+            continue;
+        }
+        int excess = job.residentCount - job.frameQuota;
+        if (victim == nullptr || excess > victimExcess) {
+            victim = &job;
+            victimExcess = excess;
+        }
+    }
+    return victim != nullptr ? victim->residentTail : -1;
+}
+
+// Function: runReclaimer
+// Purpose: Wakes the reclaimer at time `now` if free frames are below the low watermark
+void runReclaimer(vector<Job> &jobs, uint64_t now) {
+    if (!reclaimer.enabled || (int)freeFrames.size() >= reclaimer.lowFrames) {
+        return;
+    }
+    STAT_INC(reclaimWakeups);
+    int queuedWrites = pendingWriteBacks;
+    while ((int)freeFrames.size() < reclaimer.highFrames) {
+        int victim = chooseReclaimVictim(jobs);
+        if (victim == -1) {
+            break;
+        }
+        evictFrame(victim, jobs);
+        STAT_INC(reclaimedPages);
+    }
+    // Its own write-backs are not charged to any fault
+    for (; pendingWriteBacks > queuedWrites; pendingWriteBacks--) {
+        submitSwapRequest(swapDevice, now, SWAP_WRITE);
+    }
+}
+
+// Function: submitPageIO
+// Purpose: Hands the queued write-backs, and the page-in if the reference
+//          faulted, to the swap device. A fault completes once its page and
+//          the victim's write-back are both done; other writes finish in the background.
+uint64_t submitPageIO(uint64_t now, bool fault) {
+    if (flusher.enabled && now >= flusher.nextWake) {
+        flusher.nextWake = now + flusher.interval;
+        if (dirtyFrames > flusher.threshold * memoryFrames.size() && (int)freeFrames.size() < flusher.batch) {
+            flushDirtyPages(now);
+        }
+    }
+    uint64_t done = now;
+    for (; pendingWriteBacks > 0; pendingWriteBacks--) {
+        uint64_t written = submitSwapRequest(swapDevice, now, SWAP_WRITE);
+        if (fault) {
+            done = max(done, written);
+        }
+    }
+    // Read-ahead and prepaged pages come in with the faulting page as one larger read
+    int pages = (fault ? 1 : 0) + pendingReadahead + pendingPrepage + pendingHugeRead;
+    if (pages > 0) {
+        done = max(done, submitSwapRequest(swapDevice, now, SWAP_READ, pages));
+    }
+    if (fault) {
+        STAT_RECORD(faultLatency, done - now);
+    }
+    pendingReadahead = 0;
+    pendingPrepage = 0;
+    pendingHugeRead = 0;
+    if (pendingMigrationTime > 0) {
+        // Direct compaction or a copy-on-write copied pages before the reference could go on
+        done += pendingMigrationTime;
+        pendingMigrationTime = 0;
+    }
+
+    // Scattered prefetches are background reads queued behind the fault's own
+    for (int frameIndex : pendingPrefetchFrames) {
+        if (memoryFrames[frameIndex].prefetched) {
+            memoryFrames[frameIndex].readyTime = submitSwapRequest(swapDevice, now, SWAP_READ);
+        }
+    }
+    pendingPrefetchFrames.clear();
+
+    // A hit on a page whose prefetch is still in flight waits for it
+    if (prefetchHitFrame != -1) {
+        uint64_t ready = memoryFrames[prefetchHitFrame].readyTime;
+        if (ready > now) {
+            STAT_INC(latePrefetchHits);
+            STAT_ADD(prefetchStallTime, ready - now);
+            done = max(done, ready);
+        }
+        prefetchHitFrame = -1;
+    }
+    return done;
+}
+
+void printSwapDevice(uint64_t elapsedTime) {
+    const SwapDevice &d = swapDevice;
+    uint64_t requests = d.reads + d.writes;
+    cout << "Swap Device  : " << d.reads << " reads, " << d.writes << " writes";
+    if (!memoryFrames.empty()) {
+        cout << " (" << d.pagesWritten * memoryFrames[0].frameSize / 1024 << " KB written back)";
+    }
+    if (requests > 0) {
+        cout << ", " << fixed << setprecision(1) << (double)d.serviceTime / requests << " avg service ("
+             << (double)d.queueWait / requests << " queued)";
+    }
+    if (elapsedTime > 0) {
+        cout << ", " << fixed << setprecision(1) << 100.0 * d.busyTime / elapsedTime << "% busy";
+    }
+    cout << "\n";
+    if (flusher.enabled) {
+        cout << "Flusher      : " << flusher.passes << " passes, " << flusher.pagesCleaned << " pages cleaned in "
+             << flusher.writes << " writes";
+        if (flusher.writes > 0) {
+            cout << " (" << fixed << setprecision(1) << (double)flusher.pagesCleaned / flusher.writes << " pages per write)";
+        }
+        cout << "\n";
+    }
+}
+
+/*
+    LOAD CONTROL (medium-term swapper)
+    When the working sets of the running jobs add up to more than memory,
+    every job keeps evicting pages the others need and the fault rate
+    explodes (thrashing). The controller watches the global fault rate over
+    windows of `window` references:
+    - rate above highRate: suspend one job and swap out all its pages.
+      The victim is the lowest priority job, the one holding the most
+      frames among those. The last running job is never suspended.
+    - rate below lowRate : resume the job that has been suspended longest.
+    References from a suspended job are deferred: they wait in the job's
+    queue and are served, in order, as soon as it is resumed. The queue holds
+    at most MAX_DEFERRED_REFERENCES; later references are dropped (an exit
+    is always kept, so the job still terminates).
+*/
+const size_t MAX_DEFERRED_REFERENCES = 65536;
+
+struct LoadController {
+    bool enabled = false;
+    int window = 10000;
+    double highRate = 0.1;
+    double lowRate = 0.02;
+    int windowReferences = 0;
+    int windowFaults = 0;
+    deque<int> suspendedJobs; // job table indexes, oldest suspension first
+    deque<int> resumedJobs; // resumed, deferred references not replayed yet
+    uint64_t suspensions = 0;
+    uint64_t resumptions = 0;
+    uint64_t pagesSwappedOut = 0;
+};
+
+LoadController loadController;
+
+// Function: suspendJob
+// Purpose: Swaps a job out: every frame it holds goes back to the free list.
+//          Its working set (the tracked one, else its resident pages) is saved
+//          for prepaging when it resumes.
+void suspendJob(vector<Job> &jobs, int index) {
+    Job &job = jobs[index];
+    job.savedWorkingSet.clear();
+    if (restoreOnResume) {
+        if (!job.windowCount.empty()) {
+            for (int page = 0; page < (int)job.windowCount.size(); page++) {
+                if (job.windowCount[page] > 0) {
+                    job.savedWorkingSet.push_back(page);
+                }
+            }
+        } else {
+            for (int frame = job.residentTail; frame != -1; frame = memoryFrames[frame].jobPrevFrame) {
+                job.savedWorkingSet.push_back(memoryFrames[frame].pageNumber);
+            }
+        }
+    }
+    while (job.residentHead != -1) {
+        int frameIndex = job.residentHead;
+        if (!unshareMapping(job, memoryFrames[frameIndex].pageNumber, frameIndex)) {
+            writeBackIfDirty(frameIndex);
+            releaseFrame(job, frameIndex, false);
+            loadController.pagesSwappedOut++;
+        }
+    }
+    unmapSharedPages(job);
+    job.suspended = true;
+    loadController.suspendedJobs.push_back(index);
+    loadController.suspensions++;
+}
+
+// Function: checkLoadControl
+// Purpose: Counts one served reference and, at the end of each window,
+//          suspends or resumes a job based on the window's fault rate
+void checkLoadControl(vector<Job> &jobs, bool fault) {
+    LoadController &lc = loadController;
+    lc.windowReferences++;
+    lc.windowFaults += fault;
+    if (lc.windowReferences < lc.window) {
+        return;
+    }
+    double rate = (double)lc.windowFaults / lc.windowReferences;
+    lc.windowReferences = lc.windowFaults = 0;
+
+    if (rate > lc.highRate) {
+        int victim = -1;
+        int running = 0;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            if (jobs[i].suspended || jobs[i].residentCount == 0) {
+                continue;
+            }
+            running++;
+            if (victim == -1 || jobs[i].priority < jobs[victim].priority ||
+                (jobs[i].priority == jobs[victim].priority && jobs[i].residentCount > jobs[victim].residentCount)) {
+                victim = i;
+            }
+        }
+        if (running > 1) {
+            suspendJob(jobs, victim);
+        }
+    } else if (rate < lc.lowRate && !lc.suspendedJobs.empty()) {
+        jobs[lc.suspendedJobs.front()].suspended = false;
+        jobs[lc.suspendedJobs.front()].restorePending = true;
+        lc.resumedJobs.push_back(lc.suspendedJobs.front());
+        lc.suspendedJobs.pop_front();
+        lc.resumptions++;
+    }
+}
+
+/*
+    Replay statistics
+    Shared by trace replay and generated workloads.
+*/
+struct ReplayStats {
+    uint64_t references = 0;
+    uint64_t faults = 0;
+    uint64_t minorFaults = 0; // zero page faults, served without a swap read
+    uint64_t unknownJob = 0;
+    uint64_t outOfBounds = 0;
+    uint64_t exits = 0;
+    uint64_t usedFrameSum = 0; // frames in use, summed over served references
+    uint64_t pageTableSum = 0; // page table entries in use (a huge page is one), summed likewise
+    uint64_t savedFrameSum = 0; // frames saved by sharing, summed likewise
+    uint64_t deferred = 0; // references from suspended jobs still waiting to be served
+    uint64_t dropped = 0; // references from suspended jobs whose queue was full
+    bool scheduled = false; // the CPU scheduler keeps time itself
+    uint64_t clock = 0; // virtual time of a replay
+    uint64_t accessTimeSum = 0; // time from issuing each served reference to its completion
+    bool corrupt = false; // a corrupt block stopped the trace early
+};
+
+// Function: sampleWorkingSets
+// Purpose: Records every job's working set size for the time series
+void sampleWorkingSets(const vector<Job> &jobs, uint64_t time) {
+    WorkingSetSample sample;
+    sample.time = time;
+    for (const auto &job : jobs) {
+        sample.sizes.push_back(job.workingSetSize);
+    }
+    workingSetSeries.push_back(move(sample));
+}
+
+// Function: printWorkingSets
+// Purpose: Per-job working set summary, then the time series
+//          (to a CSV file if one is given, otherwise as a table)
+void printWorkingSets(const vector<Job> &jobs, const string &seriesFile) {
+    cout << "\n--- Working Sets (delta = " << workingSetWindow << " references) ---\n";
+    cout << left << setw(8) << "Job ID" << setw(10) << "Pages" << setw(10) << "Now" << setw(10) << "Average"
+         << setw(10) << "Max" << "\n";
+    for (const auto &job : jobs) {
+        cout << left << setw(8) << job.jobID << setw(10) << job.pages.size() << setw(10) << job.workingSetSize;
+        ostringstream average;
+        if (job.references > 0) average << fixed << setprecision(1) << (double)job.workingSetSum / job.references;
+        else average << "-";
+        cout << setw(10) << average.str() << setw(10) << job.workingSetMax << "\n";
+    }
+
+    if (!seriesFile.empty()) {
+        ofstream out(seriesFile);
+        out << "time,jobID,workingSetSize\n";
+        for (const auto &sample : workingSetSeries) {
+            for (size_t j = 0; j < jobs.size(); j++) {
+                out << sample.time << "," << jobs[j].jobID << "," << sample.sizes[j] << "\n";
+            }
+        }
+        if (!out) {
+            cerr << "Error writing file: " << seriesFile << endl;
+        } else {
+            cout << "Time series (" << workingSetSeries.size() << " samples) written to " << seriesFile << "\n";
+        }
+        return;
+    }
+    cout << "\n" << left << setw(14) << "Reference";
+    for (const auto &job : jobs) {
+        cout << setw(8) << ("Job " + to_string(job.jobID));
+    }
+    cout << "\n";
+    for (const auto &sample : workingSetSeries) {
+        cout << left << setw(14) << sample.time;
+        for (int size : sample.sizes) {
+            cout << setw(8) << size;
+        }
+        cout << "\n";
+    }
+}
+
+// Function: serveReference
+// Purpose: Runs one reference of a job that is not suspended through the
+//          paging engine; true if it faulted
+bool serveReference(Job &job, int logicalAddress, bool write, vector<Job> &jobs, ReplayStats &stats) {
+#ifndef NO_PAGING_STATS
+    auto begin = chrono::steady_clock::now();
+#endif
+    if (logicalAddress == TRACE_EXIT_ADDRESS) {
+        terminateJob(job);
+        stats.exits++;
+        return false;
+    }
+    int pageNumber = logicalAddress / job.pageSize;
+    if (logicalAddress < 0 || pageNumber >= (int)job.pages.size()) {
+        stats.outOfBounds++;
+        return false;
+    }
+
+    // A job starting or coming back from being swapped out
+    if (!job.started || job.restorePending) {
+        if (!job.started) {
+            STAT_INC(admissions);
+            Job *parent = job.parentID > 0 ? findJob(jobs, job.parentID) : nullptr;
+            if (parent != nullptr && parent->started) {
+                cloneJob(*parent, job, jobs);
+            }
+            if (prepagePages > 0) {
+                vector<int> firstPages(min(prepagePages, (int)job.pages.size()));
+                iota(firstPages.begin(), firstPages.end(), 0);
+                prepageJob(job, firstPages, jobs);
+            }
+        } else {
+            STAT_INC(resumes);
+            prepageJob(job, job.savedWorkingSet, jobs);
+            job.savedWorkingSet.clear();
+        }
+        job.started = true;
+        job.restorePending = false;
+        job.startupReferences = startupWindow;
+    }
+
+    int faultsBefore = job.pageFaults;
+    int minorFaultsBefore = job.minorFaults;
+    job.references++;
+    loadPage(job, pageNumber, jobs, write);
+    job.residentSum += job.residentCount;
+    bool fault = job.pageFaults != faultsBefore;
+    bool minorFault = job.minorFaults != minorFaultsBefore;
+    stats.faults += fault;
+    stats.minorFaults += minorFault;
+    if (job.startupReferences > 0) {
+        job.startupReferences--;
+        if (fault) {
+            STAT_INC(startupFaults);
+        }
+    }
+    stats.usedFrameSum += memoryFrames.size() - freeFrames.size();
+    stats.pageTableSum += memoryFrames.size() - freeFrames.size() - (uint64_t)hugePages.mapped * max(hugePages.frames - 1, 0);
+    stats.savedFrameSum += sharing.extraMappings;
+    if (!stats.scheduled) {
+        // Nothing else runs while the page comes in
+        uint64_t issued = stats.clock;
+        stats.clock = submitPageIO(issued, fault) + 1;
+        stats.accessTimeSum += stats.clock - issued;
+        runReclaimer(jobs, stats.clock);
+        // Only once the reference's reads are issued may khugepaged and KSM move or free frames
+        if (promoter.enabled) {
+            runPromoter(jobs);
+        }
+        if (ksm.enabled) {
+            runSamePageMerging(jobs);
+        }
+    }
+    if (loadController.enabled) {
+        checkLoadControl(jobs, fault || minorFault);
+    }
+    STAT_RECORD(referenceLatency, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - begin).count());
+    return fault;
+}
+
+// Function: replayReference
+// Purpose: Runs one trace reference through the paging engine; true if it faulted.
+//          A suspended job's reference is queued until the job is resumed, and
+//          the queues of jobs resumed meanwhile are replayed after it.
+inline bool replayReference(const TraceRecord &record, vector<Job> &jobs, ReplayStats &stats) {
+    stats.references++;
+    STAT_INC(references);
+    if (workingSetWindow > 0 && stats.references % workingSetSampleInterval == 0) {
+        sampleWorkingSets(jobs, stats.references);
+    }
+    Job *found = findJob(jobs, record.jobID);
+    if (found == nullptr) {
+        stats.unknownJob++;
+        return false;
+    }
+    if (found->suspended) {
+        if (found->deferredReferences.size() >= MAX_DEFERRED_REFERENCES && record.logicalAddress != TRACE_EXIT_ADDRESS) {
+            stats.dropped++;
+            return false;
+        }
+        found->deferredReferences.push_back({record.logicalAddress, record.write});
+        stats.deferred++;
+        return false;
+    }
+    bool fault = serveReference(*found, record.logicalAddress, record.write, jobs, stats);
+
+    deque<int> &resumed = loadController.resumedJobs;
+    while (!resumed.empty()) {
+        Job &job = jobs[resumed.front()];
+        resumed.pop_front();
+        // Stop if serving its backlog gets it suspended again
+        while (!job.suspended && !job.deferredReferences.empty()) {
+            pair<int, bool> deferred = job.deferredReferences.front();
+            job.deferredReferences.pop_front();
+            stats.deferred--;
+            serveReference(job, deferred.first, deferred.second, jobs, stats);
+        }
+    }
+    return fault;
+}
+
+void printReplayStats(const string &title, const ReplayStats &stats, double seconds) {
+    uint64_t served = stats.references - stats.unknownJob - stats.outOfBounds - stats.exits - stats.deferred - stats.dropped;
+
+    cout << "\n--- " << title << " ---\n";
+    cout << "References   : " << stats.references << "\n";
+    cout << "Page Hits    : " << served - stats.faults - stats.minorFaults << "\n";
+    cout << "Page Faults  : " << stats.faults << "\n";
+    if (stats.minorFaults > 0) cout << "Minor Faults : " << stats.minorFaults << " (zero page, no swap read)\n";
+    if (served > 0) {
+        cout << "Fault Rate   : " << fixed << setprecision(4) << (double)stats.faults / served << "\n";
+    }
+    if (stats.unknownJob > 0) cout << "Unknown Job  : " << stats.unknownJob << "\n";
+    if (stats.outOfBounds > 0) cout << "Out of Bounds: " << stats.outOfBounds << "\n";
+    if (stats.exits > 0) cout << "Job Exits    : " << stats.exits << "\n";
+    if (stats.deferred > 0) cout << "Deferred     : " << stats.deferred << " (job still suspended at the end)\n";
+    if (stats.dropped > 0) cout << "Dropped      : " << stats.dropped << " (job suspended, its queue full)\n";
+    if (served > 0 && stats.clock > 0) {
+        cout << "Access Time  : " << fixed << setprecision(2) << (double)stats.accessTimeSum / served
+             << " time units effective (a hit is 1)\n";
+        cout << "Throughput   : " << fixed << setprecision(2) << 1000.0 * served / stats.clock
+             << " references per 1000 time units\n";
+        printSwapDevice(stats.clock);
+    }
+    if (loadController.enabled) {
+        cout << "Load Control : " << loadController.suspensions << " suspensions, " << loadController.resumptions
+             << " resumptions, " << loadController.pagesSwappedOut << " pages swapped out, "
+             << loadController.suspendedJobs.size() << " jobs still suspended\n";
+    }
+    if (served > 0 && !memoryFrames.empty()) {
+        cout << "Memory Used  : " << fixed << setprecision(1)
+             << 100.0 * stats.usedFrameSum / served / memoryFrames.size() << "% (average per reference)\n";
+    }
+    printFreeBlocks();
+    if (ksm.enabled) {
+        cout << "KSM          : " << ksm.wakeups << " wake-ups, " << ksm.pagesScanned << " pages scanned ("
+             << ksm.fullScans << " full scans), " << ksm.merges << " frames merged\n";
+        cout << "               scan cost " << ksm.pagesScanned * ksm.scanCost << " time units, "
+             << fixed << setprecision(2) << 1000.0 * ksm.merges / max<uint64_t>(ksm.pagesScanned, 1)
+             << " frames reclaimed per 1000 pages scanned\n";
+    }
+    if (sharing.forks > 0 || ksm.enabled) {
+        cout << "Sharing      : " << sharing.forks << " forks, " << sharing.pagesShared << " pages shared, "
+             << sharing.cowFaults << " copy-on-write faults (copies cost " << sharing.cowFaults * compaction.migrateCost
+             << " time units)\n";
+        cout << "               " << sharing.handovers << " shared frames handed to another job, "
+             << sharing.unmappedByEviction << " mappings dropped by evictions\n";
+    }
+    if (zeroPage.frame != -1) {
+        cout << "Zero Page    : " << zeroPage.faults << " read faults mapped the zero frame (no I/O), "
+             << zeroPage.firstWrites << " first writes got a zero-filled frame, "
+             << memoryFrames[zeroPage.frame].mapCount - 1 << " pages still on it\n";
+    }
+    if (sharing.forks > 0 || ksm.enabled || zeroPage.frame != -1) {
+        if (served > 0) {
+            cout << "Memory Saved : " << fixed << setprecision(1) << (double)stats.savedFrameSum / served
+                 << " frames on average, " << sharing.extraMappings << " at the end\n";
+        }
+    }
+    if (hugePages.frames > 0) {
+        cout << "Huge Pages   : " << hugePages.allocations << " mapped (" << hugePages.frames << " pages each), "
+             << hugePages.fallbacks << " fallbacks to base pages, " << hugePages.lumpyReclaims << " blocks reclaimed, "
+             << hugePages.splits << " split\n";
+        if (hugePages.fragmentedFailures > 0) {
+            cout << "               " << hugePages.fragmentedFailures
+                 << " times no free block although enough frames were free (fragmentation)\n";
+        }
+        if (compaction.enabled) {
+            cout << "Compaction   : " << compaction.runs << " blocks compacted, " << compaction.failures << " failed, "
+                 << compaction.migrations << " pages migrated (cost " << compaction.migrations * compaction.migrateCost
+                 << " time units)\n";
+        }
+        if (promoter.enabled) {
+            cout << "khugepaged   : " << promoter.wakeups << " wake-ups, " << promoter.regionsScanned << " regions scanned, "
+                 << promoter.collapses << " collapsed into huge pages, " << promoter.failures << " failed (no free block, or a page would not move)\n";
+        }
+        if (served > 0) {
+            cout << "Page Table   : " << fixed << setprecision(1) << (double)stats.pageTableSum / served
+                 << " entries on average (" << (double)stats.usedFrameSum / served << " with base pages only)\n";
+        }
+    }
+    if (tlb.sets > 0) {
+        // Reach: memory the TLB's current entries translate
+        uint64_t reachPages = 0;
+        for (uint64_t key : tlb.keys) {
+            if (key != TLB_EMPTY) {
+                reachPages += (key & TLB_HUGE_BIT) ? hugePages.frames : 1;
+            }
+        }
+        uint64_t lookups = tlb.hits + tlb.misses;
+        int pageSize = memoryFrames.empty() ? 0 : memoryFrames[0].frameSize;
+        cout << "TLB          : " << tlb.sets * tlb.ways << " entries, " << tlb.misses << " misses ("
+             << fixed << setprecision(2) << 100.0 * tlb.misses / max<uint64_t>(lookups, 1) << "% of lookups), reach "
+             << reachPages * pageSize / 1024 << " KB at the end\n";
+        if (tlbMissCost > 0) {
+            // Page walks against page copies, in the same time units
+            cout << "               page walks cost " << fixed << setprecision(0) << tlb.misses * tlbMissCost
+                 << " time units, page migrations " << compaction.migrations * compaction.migrateCost << "\n";
+        }
+    }
+    cout << "Elapsed      : " << fixed << setprecision(3) << seconds << " s";
+    if (seconds > 0) {
+        cout << " (" << (uint64_t)(stats.references / seconds) << " refs/s)";
+    }
+    cout << "\n";
+}
+
+// Function: printJobSummary
+// Purpose: Per-job faults and resident set after a batch run
+void printJobSummary(const vector<Job> &jobs) {
+    cout << "\n" << left << setw(8) << "Job ID" << setw(10) << "Pages" << setw(10) << "Quota" << setw(10) << "Resident"
+         << setw(10) << "Avg Res" << setw(12) << "References" << setw(10) << "Faults" << setw(10) << "Minor"
+         << setw(10) << "Fault %" << "\n";
+    for (const auto &job : jobs) {
+        cout << left << setw(8) << job.jobID << setw(10) << job.pages.size()
+             << setw(10) << (job.frameQuota > 0 ? to_string(job.frameQuota) : "-") << setw(10) << job.residentCount;
+        ostringstream average;
+        if (job.references > 0) average << fixed << setprecision(1) << (double)job.residentSum / job.references;
+        else average << "-";
+        cout << setw(10) << average.str() << setw(12) << job.references << setw(10) << job.pageFaults
+             << setw(10) << job.minorFaults;
+        if (job.references > 0) {
+            // Minor faults are faults too, even without the swap read
+            cout << fixed << setprecision(2) << 100.0 * (job.pageFaults + job.minorFaults) / job.references;
+        } else {
+            cout << "-";
+        }
+        cout << "\n";
+    }
+}
+
+// Function: replayTraceFile
+// Purpose: Streams the selected slice of a compressed trace through the engine;
+//          false if the trace cannot be opened
+bool replayTraceFile(const string &traceFile, vector<Job> &jobs, const SimOptions &options, ReplayStats &stats) {
+    TraceDecoder decoder;
+    if (!openTraceDecoder(decoder, traceFile, options.startRecord)) {
+        return false;
+    }
+    startTraceDecoder(decoder);
+    vector<TraceRecord> block;
+    while (stats.references < options.maxRecords && nextTraceBlock(decoder, block)) {
+        size_t count = min<uint64_t>(block.size(), options.maxRecords - stats.references);
+        for (size_t i = 0; i < count; i++) {
+            replayReference(block[i], jobs, stats);
+        }
+        checkStatsDump();
+    }
+    stats.corrupt = decoder.corrupt;
+    closeTraceDecoder(decoder);
+    return true;
+}
+
+// Function: replayTrace
+// Purpose: Streams a compressed trace through loadPage and reports hits/faults
+bool replayTrace(const string &traceFile, vector<Job> &jobs, const SimOptions &options) {
+    ReplayStats stats;
+    auto start = chrono::steady_clock::now();
+    if (!replayTraceFile(traceFile, jobs, options, stats)) {
+        return false;
+    }
+
+    printReplayStats("Trace Replay", stats, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    printJobSummary(jobs);
+    if (workingSetWindow > 0) {
+        printWorkingSets(jobs, options.workingSetOut);
+    }
+    printPagingStats();
+    if (stats.corrupt) {
+        cerr << "Trace stopped early: corrupt block in " << traceFile << endl;
+    }
+    return !stats.corrupt;
+}
+
+/*
+    SYNTHETIC WORKLOAD GENERATOR
+    Builds reference streams for the jobs in the jobs file, one pattern per job:
+    - seq     : sequential scan over every page, wrapping around
+    - loop    : tight loop over the first loopPages pages
+    - zipf    : skewed random pages (a few hot pages, a long cold tail)
+    - phased  : uniform references inside a working set that jumps every phaseLength refs
+    - chase   : pointer chasing along a random cycle through all pages
+    - stride  : column walk, stridePages apart, shifting by one page each pass
+    - mixed   : job i gets pattern i mod 5 (the first five), closest to a production mix
+    Jobs take turns issuing `burst` references each. With a churn length,
+    a job exits (an exit record) after that many references and restarts.
+    A forked child (--fork) runs its parent's pattern; it starts once the
+    parent has issued forkAfter references, at the parent's current position.
+*/
+enum WorkloadPattern { PATTERN_SEQUENTIAL, PATTERN_LOOP, PATTERN_ZIPF, PATTERN_PHASED, PATTERN_CHASE, PATTERN_STRIDE };
+const char *PATTERN_NAMES[] = {"seq", "loop", "zipf", "phased", "chase", "stride"};
+const int PATTERN_COUNT = 6;
+const int MIXED_PATTERN_COUNT = 5; // stride is only generated on its own
+
+// xoshiro256** - small state, a few ns per 64-bit value
+struct FastRandom {
+    uint64_t s[4];
+};
+
+void seedRandom(FastRandom &rng, uint64_t seed) {
+    // splitmix64 spreads the seed over the whole state
+    for (auto &word : rng.s) {
+        seed += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        word = z ^ (z >> 31);
+    }
+}
+
+inline uint64_t nextRandom(FastRandom &rng) {
+    uint64_t *s = rng.s;
+    uint64_t result = s[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+// Maps a random value onto [0, n) with a multiply instead of a divide
+inline uint32_t boundedRandom(uint64_t random, uint32_t n) {
+    return (uint32_t)(((random >> 32) * n) >> 32);
+}
+
+/*
+    Zipf sampling with Walker's alias table:
+    O(n) to build, then every sample is one table lookup and a compare,
+    with no branches, so a whole burst is sampled in one tight loop.
+    Ranks are scattered over the pages when the table is built, so the
+    hot pages are not all adjacent (and sampling needs no divide).
+*/
+struct ZipfTable {
+    vector<float> probability;
+    vector<uint32_t> page; // page of each column's own rank
+    vector<uint32_t> alias; // page of each column's alias rank
+};
+
+// Stride coprime with n, so rank -> (rank * stride) % n is a permutation
+uint32_t scatterStride(uint32_t n) {
+    uint32_t stride = (uint32_t)(n * 0.6180339887) | 1;
+    while (stride > 1 && gcd(stride, n) != 1) {
+        stride--;
+    }
+    return max<uint32_t>(stride, 1);
+}
+
+void buildZipfTable(ZipfTable &table, int n, double theta) {
+    vector<double> weight(n);
+    double total = 0;
+    for (int i = 0; i < n; i++) {
+        weight[i] = 1.0 / pow(i + 1.0, theta);
+        total += weight[i];
+    }
+
+    table.probability.assign(n, 1.0f);
+    table.alias.resize(n);
+    vector<uint32_t> small, large;
+    for (int i = 0; i < n; i++) {
+        weight[i] = weight[i] * n / total;
+        table.alias[i] = i;
+        (weight[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back(), l = large.back();
+        small.pop_back();
+        table.probability[s] = (float)weight[s];
+        table.alias[s] = l;
+        weight[l] -= 1.0 - weight[s];
+        if (weight[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    uint32_t stride = scatterStride(n);
+    table.page.resize(n);
+    for (int i = 0; i < n; i++) {
+        table.page[i] = (uint32_t)((uint64_t)i * stride % n);
+    }
+    for (auto &rank : table.alias) {
+        rank = table.page[rank];
+    }
+}
+
+void sampleZipfBatch(const ZipfTable &table, const uint64_t *random, uint32_t *pages, int count) {
+    uint32_t n = table.alias.size();
+    const float *probability = table.probability.data();
+    const uint32_t *page = table.page.data();
+    const uint32_t *alias = table.alias.data();
+    for (int i = 0; i < count; i++) {
+        uint32_t column = boundedRandom(random[i], n);
+        float u = (uint32_t)random[i] * (1.0f / 4294967296.0f);
+        pages[i] = u < probability[column] ? page[column] : alias[column];
+    }
+}
+
+// Per-job generator state
+struct WorkloadJob {
+    int jobID;
+    int jobSize;
+    int pageSize;
+    int numPages;
+    WorkloadPattern pattern;
+    uint32_t cursor = 0; // seq/loop position, chase current page, phased refs into phase
+    uint32_t phaseBase = 0;
+    const ZipfTable *zipf = nullptr;
+    vector<uint32_t> nextPage; // chase: random single cycle through the pages
+    uint64_t lifetime = 0; // references since the job (re)started
+    uint64_t references = 0; // references over all its lifetimes
+    int parent = -1; // fork: workload index of its parent (-1 = not a fork)
+    bool forked = false; // fork: has taken over its parent's position
+};
+
+bool parsePattern(const string &name, int &pattern) {
+    for (int i = 0; i < PATTERN_COUNT; i++) {
+        if (name == PATTERN_NAMES[i]) {
+            pattern = i;
+            return true;
+        }
+    }
+    if (name == "mixed") {
+        pattern = -1;
+        return true;
+    }
+    return false;
+}
+
+// Function: fillWorkloadBurst
+// Purpose: Appends `count` references of one job to the output batch
+void fillWorkloadBurst(WorkloadJob &wj, const SimOptions &options, FastRandom &rng,
+                       vector<TraceRecord> &batch, int count) {
+    const int MAX_BURST = 256;
+    uint64_t random[MAX_BURST] = {}; // picks the page (Zipf: column in the high bits, coin in the low)
+    uint64_t detail[MAX_BURST]; // picks the offset (high bits) and the write flag (low bits)
+    uint32_t pages[MAX_BURST];
+    count = min(count, MAX_BURST);
+    for (int i = 0; i < count; i++) {
+        random[i] = nextRandom(rng);
+        detail[i] = nextRandom(rng);
+    }
+
+    uint32_t n = wj.numPages;
+    switch (wj.pattern) {
+    case PATTERN_SEQUENTIAL:
+        for (int i = 0; i < count; i++) {
+            pages[i] = wj.cursor;
+            wj.cursor = (wj.cursor + 1 == n) ? 0 : wj.cursor + 1;
+        }
+        break;
+    case PATTERN_LOOP: {
+        uint32_t loop = options.loopPages > 0 ? min<uint32_t>(options.loopPages, n) : max<uint32_t>(n / 4, 1);
+        for (int i = 0; i < count; i++) {
+            pages[i] = wj.cursor;
+            wj.cursor = (wj.cursor + 1 >= loop) ? 0 : wj.cursor + 1;
+        }
+        break;
+    }
+    case PATTERN_ZIPF:
+        sampleZipfBatch(*wj.zipf, random, pages, count);
+        break;
+    case PATTERN_PHASED: {
+        uint32_t workingSet = options.workingSetPages > 0 ? min<uint32_t>(options.workingSetPages, n) : max<uint32_t>(n / 8, 1);
+        for (int i = 0; i < count; i++) {
+            if (wj.cursor++ == (uint32_t)options.phaseLength) {
+                wj.cursor = 1;
+                wj.phaseBase = boundedRandom(nextRandom(rng), n);
+            }
+            uint32_t page = wj.phaseBase + boundedRandom(random[i], workingSet);
+            pages[i] = page >= n ? page - n : page;
+        }
+        break;
+    }
+    case PATTERN_CHASE:
+        for (int i = 0; i < count; i++) {
+            pages[i] = wj.cursor;
+            wj.cursor = wj.nextPage[wj.cursor];
+        }
+        break;
+    case PATTERN_STRIDE: {
+        uint32_t stride = min<uint32_t>(options.stridePages, n);
+        for (int i = 0; i < count; i++) {
+            pages[i] = wj.cursor;
+            wj.cursor += stride;
+            if (wj.cursor >= n) {
+                // Next column: one page past where this pass started
+                wj.cursor = wj.cursor % stride + 1;
+                if (wj.cursor >= stride || wj.cursor >= n) {
+                    wj.cursor = 0;
+                }
+            }
+        }
+        break;
+    }
+    }
+
+    // Offset inside the page (the last page may be partly used), and whether it is a write
+    int lastPageBytes = wj.jobSize - (n - 1) * wj.pageSize;
+    uint64_t writeThreshold = (uint64_t)(options.writeRatio * 65536);
+    for (int i = 0; i < count; i++) {
+        int pageBytes = (pages[i] == n - 1) ? lastPageBytes : wj.pageSize;
+        int offset = (int)boundedRandom(detail[i], pageBytes);
+        bool write = (detail[i] & 0xffff) < writeThreshold;
+        batch.push_back({wj.jobID, (int)pages[i] * wj.pageSize + offset, write});
+    }
+}
+
+// Function: buildWorkload
+// Purpose: Sets up the generator state of every job that has pages
+//          (Zipf tables are shared through zipfTables, which must outlive the workload)
+bool buildWorkload(const vector<Job> &jobs, const SimOptions &options, FastRandom &rng,
+                   map<int, ZipfTable> &zipfTables, vector<WorkloadJob> &workload) {
+    int fixedPattern;
+    if (!parsePattern(options.pattern, fixedPattern)) {
+        cerr << "Unknown pattern: " << options.pattern << endl;
+        return false;
+    }
+    map<int, int> positions; // jobID -> workload index, for forked children
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const Job &job = jobs[i];
+        if (job.pages.empty()) {
+            continue;
+        }
+        auto parent = positions.find(job.parentID);
+        if (job.parentID > 0 && parent != positions.end()) {
+            // A fork runs the same program over the same data as its parent
+            WorkloadJob wj = workload[parent->second];
+            wj.jobID = job.jobID;
+            wj.lifetime = 0;
+            wj.parent = parent->second;
+            workload.push_back(move(wj));
+            continue;
+        }
+        positions[job.jobID] = workload.size();
+        WorkloadJob wj;
+        wj.jobID = job.jobID;
+        wj.jobSize = job.jobSize;
+        wj.pageSize = job.pageSize;
+        wj.numPages = job.pages.size();
+        wj.pattern = (WorkloadPattern)(fixedPattern >= 0 ? fixedPattern : (int)(i % MIXED_PATTERN_COUNT));
+
+        if (wj.pattern == PATTERN_ZIPF) {
+            auto it = zipfTables.find(wj.numPages);
+            if (it == zipfTables.end()) {
+                it = zipfTables.emplace(wj.numPages, ZipfTable()).first;
+                buildZipfTable(it->second, wj.numPages, options.zipfTheta);
+            }
+            wj.zipf = &it->second;
+        } else if (wj.pattern == PATTERN_CHASE) {
+            // Sattolo's shuffle gives a single cycle through every page
+            wj.nextPage.resize(wj.numPages);
+            for (int p = 0; p < wj.numPages; p++) wj.nextPage[p] = p;
+            for (int p = wj.numPages - 1; p > 0; p--) {
+                swap(wj.nextPage[p], wj.nextPage[boundedRandom(nextRandom(rng), p)]);
+            }
+        } else if (wj.pattern == PATTERN_PHASED) {
+            wj.phaseBase = boundedRandom(nextRandom(rng), wj.numPages);
+        }
+        workload.push_back(move(wj));
+    }
+    if (workload.empty()) {
+        cerr << "No jobs to generate references for" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Function: runWorkload
+// Purpose: Generates options.maxRecords references and writes them to a trace,
+//          replays them through the engine, or both; false if the workload cannot be built
+bool runWorkload(vector<Job> &jobs, const SimOptions &options, vector<WorkloadJob> &workload, ReplayStats &stats,
+                 TraceWriter *writer) {
+    uint64_t total = options.maxRecords == UINT64_MAX ? 1000000 : options.maxRecords;
+
+    FastRandom rng;
+    seedRandom(rng, options.seed);
+
+    map<int, ZipfTable> zipfTables; // one table per distinct page count
+    if (!buildWorkload(jobs, options, rng, zipfTables, workload)) {
+        return false;
+    }
+
+    vector<TraceRecord> batch;
+    batch.reserve(65536 + 256);
+    int burst = max(1, min(options.burst, 256));
+    // The load controller's decisions must be seen before the next burst is made
+    size_t batchLimit = (options.replay && loadController.enabled) ? 1 : 65536;
+    uint64_t generated = 0;
+    size_t nextJob = 0;
+
+    while (generated < total) {
+        batch.clear();
+        while (batch.size() < batchLimit && generated + batch.size() < total) {
+            int count = (int)min<uint64_t>(burst, total - generated - batch.size());
+            WorkloadJob &wj = workload[nextJob];
+            if (options.replay && findJob(jobs, wj.jobID)->suspended) {
+                // Swapped out: the job does not run until it is resumed
+                nextJob = (nextJob + 1 == workload.size()) ? 0 : nextJob + 1;
+                continue;
+            }
+            if (wj.parent != -1 && !wj.forked) {
+                // A fork starts once its parent has run for a while, from where the parent is
+                const WorkloadJob &parent = workload[wj.parent];
+                if (parent.references < options.forkAfter) {
+                    nextJob = (nextJob + 1 == workload.size()) ? 0 : nextJob + 1;
+                    continue;
                 }
+                wj.cursor = parent.cursor;
+                wj.phaseBase = parent.phaseBase;
+                wj.forked = true;
+            }
+            fillWorkloadBurst(wj, options, rng, batch, count);
+            wj.lifetime += count;
+            wj.references += count;
+            if (options.churnLength > 0 && wj.lifetime >= options.churnLength) {
+                batch.push_back({wj.jobID, TRACE_EXIT_ADDRESS});
+                wj.lifetime = 0;
+                wj.cursor = 0;
+            }
+            nextJob = (nextJob + 1 == workload.size()) ? 0 : nextJob + 1;
+        }
+        generated += batch.size();
+
+        if (writer != nullptr) {
+            for (const auto &record : batch) {
+                appendTraceRecord(*writer, record.jobID, record.logicalAddress, record.write);
+            }
+        }
+        if (options.replay) {
+            for (const auto &record : batch) {
+                replayReference(record, jobs, stats);
+            }
+            if (generated % 65536 < batch.size()) {
+                checkStatsDump();
             }
         }
     }
-    
-    // Load the new page
-    memoryFrames[frameIndex].isFree = false;
-    memoryFrames[frameIndex].jobID = job.jobID;
-    memoryFrames[frameIndex].pageNumber = pageNumber;
-    memoryFrames[frameIndex].accessTime = currentTime;
-    
-    // Update job's page table and loaded pages
-    job.pageTable[pageNumber] = memoryFrames[frameIndex].frameID;
-    job.loadedPages.insert(pageNumber);
-    
-    // Add to FIFO queue
-    fifoQueue.push(frameIndex);
-    
     return true;
 }
 
-// Function to load job pages into page frames randomly (OLD METHOD - NOT DEMAND PAGING)
-void assignPageFrames(Job &job){
-    // Check if memory has enough free frames for this job
-    int freeFrames = count_if(memoryFrames.begin(), memoryFrames.end(), [](PageFrame &f){ return f.isFree; });
-    if (job.pages.size() > freeFrames) {
-        cerr << "Not enough free frames to load Job ID " << job.jobID << endl;
+// Function: generateWorkload
+// Purpose: Generates the workload, writing it as a trace and/or replaying it, and reports
+void generateWorkload(vector<Job> &jobs, const SimOptions &options) {
+    uint64_t generated = options.maxRecords == UINT64_MAX ? 1000000 : options.maxRecords;
+    TraceWriter writer;
+    if (!options.outFile.empty() && !openTraceWriter(writer, options.outFile)) {
+        return;
+    }
+    vector<WorkloadJob> workload;
+    ReplayStats stats;
+    auto start = chrono::steady_clock::now();
+    if (!runWorkload(jobs, options, workload, stats, options.outFile.empty() ? nullptr : &writer)) {
         return;
     }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    for (int page: job.pages) {
-        int frameIndex;
-        do {
-            frameIndex = rand() % memoryFrames.size();
-        } while (!memoryFrames[frameIndex].isFree);
-        
-        // Assign frame to page
-        memoryFrames[frameIndex].isFree = false;
-        memoryFrames[frameIndex].jobID = job.jobID;
-        memoryFrames[frameIndex].pageNumber = page;
+    if (!options.outFile.empty() && !closeTraceWriter(writer)) {
+        cerr << "Error writing file: " << options.outFile << endl;
+    }
 
-        // Mark frame as assigned
-        job.pageTable[page] = memoryFrames[frameIndex].frameID;
+    cout << "\n--- Workload Generator ---\n";
+    cout << "Pattern      : " << options.pattern << " (" << workload.size() << " jobs, seed " << options.seed << ")\n";
+    for (const auto &wj : workload) {
+        cout << "  Job " << wj.jobID << ": " << PATTERN_NAMES[wj.pattern] << ", " << wj.numPages << " pages\n";
+    }
+    cout << "Generated    : " << generated << " references";
+    if (seconds > 0) {
+        cout << " (" << (uint64_t)(generated / seconds) << " refs/s including output)";
+    }
+    cout << "\n";
+    if (!options.outFile.empty()) {
+        cout << "Trace Written: " << options.outFile << "\n";
+    }
+    if (options.replay) {
+        printReplayStats("Engine Replay", stats, seconds);
+        printJobSummary(jobs);
+        if (workingSetWindow > 0) {
+            printWorkingSets(jobs, options.workingSetOut);
+        }
+        printPagingStats();
     }
 }
 
-// Job list array
-// List of jobs
+/*
+    MULTIPROGRAMMED CPU SCHEDULER
+    One CPU is shared round-robin by the first `mpl` jobs of the workload:
+    - every reference takes 1 time unit of CPU
+    - a job runs until it has used its quantum or it faults
+    - a faulting job blocks until the swap device has read its page in, and
+      the CPU switches to the next ready job (or idles if none is ready)
+    CPU utilization is busy time over elapsed time. Sweeping the degree of
+    multiprogramming gives the curve used to pick a concurrency limit:
+    utilization rises while more jobs hide each other's fault waits, then
+    falls once their working sets stop fitting in memory and they thrash.
+*/
+struct ScheduleResult {
+    int mpl;
+    uint64_t served = 0;
+    uint64_t faults = 0;
+    uint64_t busyTime = 0;
+    uint64_t elapsedTime = 0;
+    double memoryUsed = 0; // average fraction of frames in use
+    double effectiveAccessTime = 0;
+    double deviceBusy = 0; // fraction of the time the swap device was busy
+};
 
-// Need to simulate the JT, PMT, MMT
-/* 
-    Job Table:
-    - Job ID
-    - Job Size
-    - No. of Pages    
-    - Pages Loaded
-    - Page Faults
+// Function: runScheduler
+// Purpose: Runs `total` references of the first mpl workload jobs on one CPU
+ScheduleResult runScheduler(vector<Job> &jobs, const SimOptions &options, int mpl, uint64_t total) {
+    ScheduleResult result;
+    result.mpl = mpl;
 
-    Page Map Table:
-    - Page Number
-    - Frame Number
-    - Loaded Status
-    - Modified/Referenced bits
+    FastRandom rng;
+    seedRandom(rng, options.seed);
+    map<int, ZipfTable> zipfTables;
+    vector<WorkloadJob> workload;
+    if (!buildWorkload(jobs, options, rng, zipfTables, workload)) {
+        return result;
+    }
+    workload.resize(min<size_t>(mpl, workload.size()));
+    if (replacementScope == LOCAL_REPLACEMENT || replacementScope == PFF_REPLACEMENT) {
+        // Quotas split memory among the admitted jobs only
+        vector<Job> admitted;
+        for (const auto &wj : workload) {
+            admitted.push_back(*findJob(jobs, wj.jobID));
+        }
+        int policy = find(begin(QUOTA_POLICY_NAMES), end(QUOTA_POLICY_NAMES), options.quota) - begin(QUOTA_POLICY_NAMES);
+        computeFrameQuotas(admitted, (QuotaPolicy)policy);
+        for (const auto &job : admitted) {
+            findJob(jobs, job.jobID)->frameQuota = job.frameQuota;
+        }
+    }
 
-    Memory Map Table:
-    - frame number
-    - availability or status (free or occupied)
-    - job id (if occupied)
-    - page number (if occupied)
-    - access time
-*/
-void displayTables(const vector<Job> &jobs) {
-    cout << "\n--- Job Table ---\n";
-    cout << left << setw(8) << "Job ID" << setw(12) << "Job Size" << setw(14) << "No. of Pages" << setw(16) << "Pages Loaded" << setw(12) << "Page Faults" << setw(24) << "Internal Fragmentation" << "\n";
-    for (const auto &job : jobs) {
-        cout << left << setw(8) << job.jobID << setw(12) << job.jobSize
-                << setw(14) << job.pages.size() << setw(16) << job.loadedPages.size() 
-                << setw(12) << job.pageFaults << setw(24) << job.internalFragmentation << "\n";
+    int n = workload.size();
+    vector<vector<TraceRecord>> pending(n); // each job's next references
+    vector<size_t> next(n, 0);
+    deque<int> ready;
+    for (int j = 0; j < n; j++) {
+        ready.push_back(j);
     }
+    // Jobs waiting for a page, earliest wake-up time first
+    priority_queue<pair<uint64_t, int>, vector<pair<uint64_t, int>>, greater<pair<uint64_t, int>>> blocked;
 
-    cout << "\n--- Page Map Table ---\n";
-    cout << left << setw(8) << "Job ID" << setw(14) << "Page Number" << setw(14) << "Frame Number" << setw(12) << "Status" << "\n";
-    for (const auto &job : jobs) {
-        for (const auto &page : job.pages) {
-            cout << left << setw(8) << job.jobID << setw(14) << page;
-            if (job.loadedPages.find(page) != job.loadedPages.end()) {
-                cout << setw(14) << job.pageTable.at(page) << setw(12) << "Loaded" << "\n";
-            } else {
-                cout << setw(14) << "-" << setw(12) << "Not Loaded" << "\n";
+    ReplayStats stats;
+    stats.scheduled = true;
+    uint64_t clock = 0;
+    while (stats.references < total) {
+        while (!blocked.empty() && blocked.top().first <= clock) {
+            ready.push_back(blocked.top().second);
+            blocked.pop();
+        }
+        if (ready.empty()) {
+            clock = blocked.top().first; // CPU idle until the next page arrives
+            continue;
+        }
+        int j = ready.front();
+        ready.pop_front();
+
+        bool faulted = false;
+        for (int q = 0; q < options.quantum && stats.references < total; q++) {
+            if (next[j] == pending[j].size()) {
+                WorkloadJob &wj = workload[j];
+                pending[j].clear();
+                next[j] = 0;
+                fillWorkloadBurst(wj, options, rng, pending[j], 256);
+                wj.lifetime += 256;
+                if (options.churnLength > 0 && wj.lifetime >= options.churnLength) {
+                    pending[j].push_back({wj.jobID, TRACE_EXIT_ADDRESS});
+                    wj.lifetime = 0;
+                    wj.cursor = 0;
+                }
+            }
+            bool fault = replayReference(pending[j][next[j]++], jobs, stats);
+            clock++;
+            result.busyTime++;
+            uint64_t done = submitPageIO(clock, fault);
+            runReclaimer(jobs, clock);
+            if (promoter.enabled) {
+                runPromoter(jobs);
+            }
+            if (ksm.enabled) {
+                runSamePageMerging(jobs);
+            }
+            if (fault || done > clock) {
+                stats.accessTimeSum += done - clock + 1;
+                blocked.push({done, j});
+                faulted = true;
+                break;
             }
+            stats.accessTimeSum++;
+        }
+        if (!faulted) {
+            ready.push_back(j);
         }
     }
 
-    cout << "\n--- Memory Map Table ---\n";
-    cout << left << setw(14) << "Frame Number" << setw(14) << "Status" << setw(14) << "Job ID" << setw(14) << "Page Number" << "\n";
-    for (const auto &frame : memoryFrames) {
-        cout << left << setw(14) << frame.frameID;
-        if (frame.isFree) {
-            cout << setw(14) << "Free" << setw(14) << "-" << setw(14) << "-" << "\n";
-        } else {
-            cout << setw(14) << "Occupied" << setw(14) << frame.jobID << setw(14) << frame.pageNumber << "\n";
-        }
+    result.served = stats.references - stats.unknownJob - stats.outOfBounds - stats.exits;
+    result.faults = stats.faults;
+    result.elapsedTime = clock;
+    if (result.served > 0) {
+        result.memoryUsed = (double)stats.usedFrameSum / result.served / memoryFrames.size();
+        result.effectiveAccessTime = (double)stats.accessTimeSum / result.served;
     }
-    cout << endl;
+    // Requests still in flight at the end count towards the device's elapsed time
+    uint64_t deviceElapsed = max(clock, swapDevice.busyUntil);
+    result.deviceBusy = deviceElapsed > 0 ? (double)swapDevice.busyTime / deviceElapsed : 0;
+    return result;
 }
 
+// Function: runSchedulerSweep
+// Purpose: Runs the scheduler at every degree of multiprogramming from 1 up,
+//          each from empty memory, and prints the CPU utilization curve
+void runSchedulerSweep(const vector<Job> &jobs, const SimOptions &options) {
+    uint64_t total = options.maxRecords == UINT64_MAX ? 1000000 : options.maxRecords;
+    int jobsWithPages = count_if(jobs.begin(), jobs.end(), [](const Job &job) { return !job.pages.empty(); });
+    int maxMpl = options.maxMultiprogramming > 0 ? min(options.maxMultiprogramming, jobsWithPages) : jobsWithPages;
+    if (maxMpl == 0) {
+        cerr << "No jobs to schedule" << endl;
+        return;
+    }
+    loadController.enabled = false; // the sweep measures the uncontrolled curve
 
-// Import jobs from a csv file to populate into the job list
-vector<Job> importJobsFromFile(string filename, int pagesize) {
-    vector<Job> jobs;
-    ifstream file(filename);
-    string line;
+    cout << "\n--- CPU Scheduler (" << options.pattern << ", " << memoryFrames.size() << " frames, quantum "
+         << options.quantum << ", swap read " << options.swapReadLatency << ") ---\n";
+    cout << left << setw(6) << "MPL" << setw(12) << "CPU Util %" << setw(12) << "Fault Rate" << setw(14) << "Throughput"
+         << setw(12) << "Memory %" << setw(10) << "EAT" << setw(10) << "Disk %" << "\n";
+    for (int mpl = 1; mpl <= maxMpl; mpl++) {
+        vector<Job> runJobs = jobs;
+        initFrames(memoryFrames.size(), options.pageSize);
+        initHugePages(options);
+        initSamePageMerging(options);
+        buildJobIndex(runJobs);
+        initSwapDevice(options);
+        initReclaimer(options);
+        initPrefetcher(options);
+        referencesSinceReset = 0;
+        pendingWriteBacks = 0;
+        resetPagingStats();
 
-    if (!file.is_open()) {
-        cerr << "Error opening file: " << filename << endl;
-        return jobs;
+        ScheduleResult r = runScheduler(runJobs, options, mpl, total);
+        double elapsed = max<uint64_t>(r.elapsedTime, 1);
+        cout << left << setw(6) << r.mpl << fixed << setprecision(2)
+             << setw(12) << 100.0 * r.busyTime / elapsed
+             << setw(12) << setprecision(4) << (r.served > 0 ? (double)r.faults / r.served : 0.0)
+             << setw(14) << setprecision(2) << 1000.0 * r.served / elapsed
+             << setw(12) << setprecision(1) << 100.0 * r.memoryUsed
+             << setw(10) << setprecision(1) << r.effectiveAccessTime
+             << setw(10) << 100.0 * r.deviceBusy << "\n";
     }
+    cout << "(Throughput is references served per 1000 time units; EAT is the effective access time)\n";
+}
 
-    while (getline(file, line)) {
-        // Skip empty lines
-        if (line.empty()) {
+// Parses "--name value" options (plus the --replay flag) after the command arguments
+bool parseSimOptions(int argc, char *argv[], int first, SimOptions &options) {
+    for (int i = first; i < argc; i++) {
+        string name = argv[i];
+        if (name == "--replay") {
+            options.replay = true;
             continue;
         }
-        
-        stringstream ss(line);
-        string token;
-        Job job;
-
-        // CSV format: jobID, jobSize
-        getline(ss, token, ',');
-        if (token.empty()) {
-            continue; // Skip if jobID is empty
+        if (name == "--load-control") {
+            options.loadControl = true;
+            continue;
         }
-        job.jobID = stoi(token);
-        
-        getline(ss, token, ',');
-        if (token.empty()) {
-            continue; // Skip if jobSize is empty
+        if (name == "--flusher") {
+            options.flusher = true;
+            continue;
+        }
+        if (name == "--kswapd") {
+            options.reclaimer = true;
+            continue;
+        }
+        if (name == "--compaction") {
+            options.compaction = true;
+            continue;
         }
-        job.jobSize = stoi(token);
-        job.pageSize = pagesize;
+        if (name == "--zero-page") {
+            options.zeroPage = true;
+            continue;
+        }
+        if (name == "--ksm") {
+            options.ksm = true;
+            continue;
+        }
+        if (name == "--khugepaged") {
+            options.khugepaged = true;
+            continue;
+        }
+        if (name == "--prepage-resume") {
+            options.prepageResume = true;
+            continue;
+        }
+        if (name == "--readahead") {
+            options.prefetcher = "readahead";
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << name << endl;
+            return false;
+        }
+        string value = argv[++i];
+        try {
+            if (name == "--jobs") options.jobsFile = value;
+            else if (name == "--scale") options.jobScale = stoi(value);
+            else if (name == "--frames") options.numFrames = stoi(value);
+            else if (name == "--page-size") options.pageSize = stoi(value);
+            else if (name == "--start") options.startRecord = stoull(value);
+            else if (name == "--count") options.maxRecords = stoull(value);
+            else if (name == "--out") options.outFile = value;
+            else if (name == "--vs") options.compareWith = value;
+            else if (name == "--seed") options.seed = stoull(value);
+            else if (name == "--zipf") options.zipfTheta = stod(value);
+            else if (name == "--burst") options.burst = stoi(value);
+            else if (name == "--phase") options.phaseLength = stoi(value);
+            else if (name == "--working-set") options.workingSetPages = stoi(value);
+            else if (name == "--loop") options.loopPages = stoi(value);
+            else if (name == "--stride") options.stridePages = stoi(value);
+            else if (name == "--churn") options.churnLength = stoull(value);
+            else if (name == "--writes") options.writeRatio = stod(value);
+            else if (name == "--policy") options.policy = value;
+            else if (name == "--nru-interval") options.nruInterval = stoi(value);
+            else if (name == "--scope") options.scope = value;
+            else if (name == "--quota") options.quota = value;
+            else if (name == "--pff-upper") options.pffUpper = stod(value);
+            else if (name == "--pff-lower") options.pffLower = stod(value);
+            else if (name == "--ws-window") options.workingSetWindow = stoi(value);
+            else if (name == "--ws-sample") options.workingSetSample = stoull(value);
+            else if (name == "--ws-out") options.workingSetOut = value;
+            else if (name == "--fault-cost" || name == "--swap-read") options.swapReadLatency = stoi(value);
+            else if (name == "--swap-write") options.swapWriteLatency = stoi(value);
+            else if (name == "--swap-bandwidth") options.swapBandwidth = stod(value);
+            else if (name == "--swap-depth") options.swapQueueDepth = stoi(value);
+            else if (name == "--flush-threshold") options.flushThreshold = stod(value);
+            else if (name == "--flush-batch") options.flushBatch = stoi(value);
+            else if (name == "--flush-interval") options.flushInterval = stoi(value);
+            else if (name == "--wm-low") options.lowWatermark = stod(value);
+            else if (name == "--wm-high") options.highWatermark = stod(value);
+            else if (name == "--prefetch") options.prefetcher = value;
+            else if (name == "--markov-entries") options.markovEntries = stoi(value);
+            else if (name == "--prepage") options.prepage = stoi(value);
+            else if (name == "--huge-pages") options.hugePageFrames = stoi(value);
+            else if (name == "--huge-min-pages") options.hugeMinPages = stoi(value);
+            else if (name == "--tlb") options.tlbEntries = stoi(value);
+            else if (name == "--tlb-miss-cost") options.tlbMissCost = stod(value);
+            else if (name == "--migrate-cost") options.migrateCost = stoi(value);
+            else if (name == "--khugepaged-interval") options.khugepagedInterval = stoi(value);
+            else if (name == "--khugepaged-scan") options.khugepagedScan = stoi(value);
+            else if (name == "--fork") options.forkChildren = stoi(value);
+            else if (name == "--fork-after") options.forkAfter = stoull(value);
+            else if (name == "--ksm-interval") options.ksmInterval = stoi(value);
+            else if (name == "--ksm-pages") options.ksmPages = stoi(value);
+            else if (name == "--ksm-scan-cost") options.ksmScanCost = stoi(value);
+            else if (name == "--startup-window") options.startupWindow = stoi(value);
+            else if (name == "--ra-min") options.readaheadMin = stoi(value);
+            else if (name == "--ra-max") options.readaheadMax = stoi(value);
+            else if (name == "--lc-window") options.loadWindow = stoi(value);
+            else if (name == "--lc-high") options.loadHigh = stod(value);
+            else if (name == "--lc-low") options.loadLow = stod(value);
+            else if (name == "--quantum") options.quantum = stoi(value);
+            else if (name == "--mpl") options.maxMultiprogramming = stoi(value);
+            else {
+                cerr << "Unknown option: " << name << endl;
+                return false;
+            }
+        } catch (const logic_error &) {
+            // stoi and friends: not a number, or out of range
+            cerr << "Invalid value for " << name << ": " << value << endl;
+            return false;
+        }
+    }
+    if (options.numFrames <= 0 || options.pageSize <= 0 || options.jobScale <= 0) {
+        cerr << "Frame count, page size and job scale must be positive" << endl;
+        return false;
+    }
+    if (find(begin(POLICY_NAMES), end(POLICY_NAMES), options.policy) == end(POLICY_NAMES)) {
+        cerr << "Policy must be fifo, nru or clean" << endl;
+        return false;
+    }
+    if (options.writeRatio < 0 || options.writeRatio > 1 || options.nruInterval <= 0) {
+        cerr << "Write fraction must be between 0 and 1, NRU interval positive" << endl;
+        return false;
+    }
+    if (find(begin(SCOPE_NAMES), end(SCOPE_NAMES), options.scope) == end(SCOPE_NAMES)) {
+        cerr << "Scope must be global, local, pff or ws" << endl;
+        return false;
+    }
+    if (options.pffLower <= 0 || options.pffUpper <= options.pffLower) {
+        cerr << "PFF thresholds need 0 < --pff-lower < --pff-upper" << endl;
+        return false;
+    }
+    if (find(begin(QUOTA_POLICY_NAMES), end(QUOTA_POLICY_NAMES), options.quota) == end(QUOTA_POLICY_NAMES)) {
+        cerr << "Quota must be equal, proportional or priority" << endl;
+        return false;
+    }
+    if (options.workingSetWindow < 0 || options.workingSetSample == 0) {
+        cerr << "Working set window and sample interval must be positive" << endl;
+        return false;
+    }
+    if (options.scope == "ws" && options.workingSetWindow == 0) {
+        options.workingSetWindow = 1000;
+    }
+    if (options.swapReadLatency < 0 || options.swapWriteLatency < 0 || options.swapBandwidth < 0 ||
+        options.swapQueueDepth < 0) {
+        cerr << "Swap device latencies, bandwidth and queue depth cannot be negative" << endl;
+        return false;
+    }
+    if (options.lowWatermark < 0 || options.highWatermark < options.lowWatermark || options.highWatermark >= 1) {
+        cerr << "Watermarks need 0 <= --wm-low <= --wm-high < 1" << endl;
+        return false;
+    }
+    if (options.flushThreshold < 0 || options.flushThreshold > 1 || options.flushBatch <= 0 || options.flushInterval <= 0) {
+        cerr << "Flush threshold must be between 0 and 1, flush batch positive" << endl;
+        return false;
+    }
+    if (find(begin(PREFETCHER_NAMES), end(PREFETCHER_NAMES), options.prefetcher) == end(PREFETCHER_NAMES)) {
+        cerr << "Unknown prefetcher: " << options.prefetcher << endl;
+        return false;
+    }
+    if (options.hugePageFrames < 0 || options.hugePageFrames == 1 ||
+        (options.hugePageFrames & (options.hugePageFrames - 1)) != 0) {
+        cerr << "Huge pages must be a power of two of at least 2 base pages" << endl;
+        return false;
+    }
+    if (options.hugeMinPages < 0 || options.tlbEntries < 0) {
+        cerr << "Huge page job size and TLB entries cannot be negative" << endl;
+        return false;
+    }
+    if ((options.compaction || options.khugepaged) && options.hugePageFrames == 0) {
+        cerr << "Compaction and khugepaged need --huge-pages" << endl;
+        return false;
+    }
+    if (options.migrateCost < 0 || options.tlbMissCost < 0 || options.khugepagedInterval <= 0 ||
+        options.khugepagedScan <= 0) {
+        cerr << "Migration and TLB miss costs cannot be negative, khugepaged interval and scan must be positive" << endl;
+        return false;
+    }
+    if (options.forkChildren < 0 || options.forkChildren > 64) {
+        cerr << "Fork children must be between 0 and 64" << endl;
+        return false;
+    }
+    if (options.zeroPage && options.numFrames < 2) {
+        cerr << "The zero page needs at least 2 frames" << endl;
+        return false;
+    }
+    if (options.zeroPage && options.ksm) {
+        // Their content models disagree: KSM takes an unwritten page to hold its program image
+        cerr << "The zero page cannot be combined with KSM" << endl;
+        return false;
+    }
+    if (options.ksmInterval <= 0 || options.ksmPages <= 0 || options.ksmScanCost < 0) {
+        cerr << "KSM interval and pages must be positive, scan cost not negative" << endl;
+        return false;
+    }
+    if (options.prepage < 0 || options.startupWindow < 0) {
+        cerr << "Prepage pages and startup window cannot be negative" << endl;
+        return false;
+    }
+    if (options.markovEntries <= 0) {
+        cerr << "Markov table needs at least one entry" << endl;
+        return false;
+    }
+    if (options.readaheadMin <= 0 || options.readaheadMax < options.readaheadMin) {
+        cerr << "Read-ahead windows need 0 < --ra-min <= --ra-max" << endl;
+        return false;
+    }
+    if (options.loadWindow <= 0 || options.loadLow >= options.loadHigh) {
+        cerr << "Load control needs a positive window and --lc-low < --lc-high" << endl;
+        return false;
+    }
+    if (options.quantum <= 0 || options.maxMultiprogramming < 0) {
+        cerr << "Quantum must be positive" << endl;
+        return false;
+    }
+    if (options.phaseLength <= 0 || options.stridePages <= 0) {
+        cerr << "Phase length and stride must be positive" << endl;
+        return false;
+    }
+    return true;
+}
 
-        divideJobIntoPages(job);
-        jobs.push_back(job);
+// Function: loadJobsForRun
+// Purpose: Builds memory and imports (and optionally scales) the jobs for a batch run
+vector<Job> loadJobsForRun(const SimOptions &options) {
+    initFrames(options.numFrames, options.pageSize);
+    initHugePages(options);
+    vector<Job> jobs = importJobsFromFile(options.jobsFile, options.pageSize);
+    if (options.jobScale > 1) {
+        for (auto &job : jobs) {
+            if (job.jobSize > INT_MAX / options.jobScale) {
+                cerr << "Job " << job.jobID << " is too large to scale by " << options.jobScale << endl;
+                continue;
+            }
+            job.jobSize *= options.jobScale;
+            job.pages.clear();
+            divideJobIntoPages(job);
+        }
+    }
+    if (options.forkChildren > 0) {
+        // Forked children get new IDs after the largest one and run their parent's pattern
+        int nextID = 0;
+        for (const auto &job : jobs) {
+            nextID = max(nextID, job.jobID);
+        }
+        size_t parents = jobs.size();
+        for (size_t i = 0; i < parents; i++) {
+            for (int c = 0; c < options.forkChildren && !jobs[i].pages.empty(); c++) {
+                Job child = jobs[i];
+                child.jobID = ++nextID;
+                child.parentID = jobs[i].jobID;
+                jobs.push_back(child);
+            }
+        }
+        buildJobIndex(jobs);
+    }
+    if (options.ksm || options.zeroPage) {
+        for (auto &job : jobs) {
+            job.written.assign(job.pages.size(), false);
+        }
     }
+    initSamePageMerging(options);
 
-    file.close();
+    replacementScope = (ReplacementScope)(find(begin(SCOPE_NAMES), end(SCOPE_NAMES), options.scope) - begin(SCOPE_NAMES));
+    replacementPolicy = (ReplacementPolicy)(find(begin(POLICY_NAMES), end(POLICY_NAMES), options.policy) - begin(POLICY_NAMES));
+    nruResetInterval = options.nruInterval;
+    referencesSinceReset = 0;
+    pendingWriteBacks = 0;
+    initPrefetcher(options);
+    prepagePages = options.prepage;
+    restoreOnResume = options.prepageResume;
+    startupWindow = options.startupWindow;
+    pffUpperRate = options.pffUpper;
+    pffLowerRate = options.pffLower;
+    workingSetWindow = options.workingSetWindow;
+    workingSetSampleInterval = options.workingSetSample;
+    workingSetSeries.clear();
+    initSwapDevice(options);
+    initReclaimer(options);
+    loadController = LoadController();
+    loadController.enabled = options.loadControl;
+    loadController.window = options.loadWindow;
+    loadController.highRate = options.loadHigh;
+    loadController.lowRate = options.loadLow;
+    if (replacementScope == LOCAL_REPLACEMENT || replacementScope == PFF_REPLACEMENT) {
+        int policy = find(begin(QUOTA_POLICY_NAMES), end(QUOTA_POLICY_NAMES), options.quota) - begin(QUOTA_POLICY_NAMES);
+        computeFrameQuotas(jobs, (QuotaPolicy)policy);
+    }
     return jobs;
-}   
+}
 
-// Address resolution function with demand paging
-// Resolve logical address based on user input
-void resolveAddress(Job &job, int logicalAddress, vector<Job> &allJobs) {
-    int pageNumber = logicalAddress / job.pageSize;
-    int offset = logicalAddress % job.pageSize;
+/*
+    SIDE-BY-SIDE COMPARISON
+    Runs one workload (a generated pattern or a .dpt trace) once per
+    configuration, each from empty memory in the same process, and prints
+    the results in columns. The configurations differ only in the setting
+    named by --vs:
+    - load-control : without and with the load controller
+    - scope        : fixed local quotas and page-fault-frequency quotas
+    - flusher      : without and with background write-back, with the
+                     fault latency percentiles
+*/
+struct ComparisonRun {
+    string label;
+    ReplayStats stats;
+    PagingStats paging;
+    LoadController loadControl;
+    Flusher flusher;
+};
 
-    if (pageNumber >= job.pages.size()) {
-        cout << "Logical address out of bounds for Job ID " << job.jobID << endl;
-        return;
+// Function: comparisonVariants
+// Purpose: The configurations a comparison runs, labelled; empty for an unknown --vs
+vector<pair<string, SimOptions>> comparisonVariants(const SimOptions &options) {
+    vector<pair<string, SimOptions>> variants;
+    if (options.compareWith == "load-control") {
+        SimOptions without = options, with = options;
+        without.loadControl = false;
+        with.loadControl = true;
+        variants = {{"without", without}, {"load-control", with}};
+    } else if (options.compareWith == "scope") {
+        SimOptions local = options, pff = options;
+        local.scope = "local";
+        pff.scope = "pff";
+        variants = {{"local", local}, {"pff", pff}};
+    } else if (options.compareWith == "flusher") {
+        SimOptions without = options, with = options;
+        without.flusher = false;
+        with.flusher = true;
+        variants = {{"without", without}, {"flusher", with}};
     }
+    return variants;
+}
 
-    // Check if page is loaded, if not, load it using demand paging
-    if (job.loadedPages.find(pageNumber) == job.loadedPages.end()) {
-        cout << "Page " << pageNumber << " not in memory. Loading page on demand...\n";
-        loadPage(job, pageNumber, allJobs);
+// Function: runComparison
+// Purpose: Runs the workload under each configuration and prints them side by side
+bool runComparison(const string &source, const SimOptions &options) {
+    vector<pair<string, SimOptions>> variants = comparisonVariants(options);
+    if (variants.empty()) {
+        cerr << "Compare needs --vs load-control|scope|flusher" << endl;
+        return false;
     }
+    bool fromTrace = source.size() > 4 && source.compare(source.size() - 4, 4, ".dpt") == 0;
 
-    int frameNumber = job.pageTable[pageNumber];
-    int physicalAddress = frameNumber * job.pageSize + offset;
+    vector<ComparisonRun> runs;
+    for (auto &variant : variants) {
+        SimOptions runOptions = variant.second;
+        runOptions.pattern = source;
+        runOptions.replay = true;
+        runOptions.outFile.clear();
+        vector<Job> jobs = loadJobsForRun(runOptions);
+        resetPagingStats();
 
-    cout << "Logical Address: " << logicalAddress << " -> Physical Address: " << physicalAddress
-        << " (Frame: " << frameNumber << ", Offset: " << offset << ")\n";
-    cout << "Page Faults for Job " << job.jobID << ": " << job.pageFaults << "\n";
-}
+        ComparisonRun run;
+        run.label = variant.first;
+        vector<WorkloadJob> workload;
+        bool ok = fromTrace ? replayTraceFile(source, jobs, runOptions, run.stats)
+                            : runWorkload(jobs, runOptions, workload, run.stats, nullptr);
+        if (!ok) {
+            return false;
+        }
+        if (run.stats.corrupt) {
+            cerr << "Trace stopped early: corrupt block in " << source << endl;
+            return false;
+        }
+        run.paging = pagingStats;
+        run.loadControl = loadController;
+        run.flusher = flusher;
+        runs.push_back(run);
+    }
 
-// Function to preview jobs from CSV
-void previewJobs(const vector<Job> &jobs) {
-    cout << "\nJobs Loaded from CSV:\n";
-    cout << left << setw(8) << "Job ID" << setw(12) << "Job Size" << setw(14) << "Pages" << setw(20) << "Fragmentation" << "\n";
-    for (auto &job : jobs) {
-        cout << left << setw(8) << job.jobID << setw(12) << job.jobSize 
-                << setw(14) << job.pages.size() << setw(20) << job.internalFragmentation << "\n";
+    cout << "\n--- Comparison (" << source << ", " << memoryFrames.size() << " frames, --vs " << options.compareWith
+         << ") ---\n";
+    cout << left << setw(18) << "";
+    for (const auto &run : runs) {
+        cout << setw(16) << run.label;
     }
+    cout << "\n";
+    auto row = [&](const string &name, int precision, auto value) {
+        cout << left << setw(18) << name << fixed << setprecision(precision);
+        for (const auto &run : runs) {
+            cout << setw(16) << value(run);
+        }
+        cout << "\n";
+    };
+    auto served = [](const ComparisonRun &run) {
+        const ReplayStats &s = run.stats;
+        return s.references - s.unknownJob - s.outOfBounds - s.exits - s.deferred - s.dropped;
+    };
+    auto perServed = [&](const ComparisonRun &run, double sum) { return served(run) > 0 ? sum / served(run) : 0.0; };
+    row("Served", 0, served);
+    row("Page Faults", 0, [](const ComparisonRun &run) { return run.stats.faults; });
+    row("Fault Rate", 4, [&](const ComparisonRun &run) { return perServed(run, run.stats.faults); });
+    row("Throughput", 2, [&](const ComparisonRun &run) {
+        return run.stats.clock > 0 ? 1000.0 * served(run) / run.stats.clock : 0.0;
+    });
+    row("EAT", 2, [&](const ComparisonRun &run) { return perServed(run, run.stats.accessTimeSum); });
+    row("Memory %", 1, [&](const ComparisonRun &run) {
+        return 100.0 * perServed(run, run.stats.usedFrameSum) / memoryFrames.size();
+    });
+    if (options.compareWith == "load-control") {
+        row("Suspensions", 0, [](const ComparisonRun &run) { return run.loadControl.suspensions; });
+        row("Deferred", 0, [](const ComparisonRun &run) { return run.stats.deferred; });
+        row("Dropped", 0, [](const ComparisonRun &run) { return run.stats.dropped; });
+    }
+    if (options.compareWith == "scope") {
+        row("Frames Held", 1, [&](const ComparisonRun &run) { return perServed(run, run.stats.usedFrameSum); });
+#ifndef NO_PAGING_STATS
+        row("Quota Grows", 0, [](const ComparisonRun &run) { return run.paging.quotaGrows; });
+        row("Quota Shrinks", 0, [](const ComparisonRun &run) { return run.paging.quotaShrinks; });
+        row("PFF Released", 0, [](const ComparisonRun &run) { return run.paging.pffReleased; });
+#endif
+    }
+    if (options.compareWith == "flusher") {
+        row("Pages Cleaned", 0, [](const ComparisonRun &run) { return run.flusher.pagesCleaned; });
+        row("Flush Writes", 0, [](const ComparisonRun &run) { return run.flusher.writes; });
+#ifndef NO_PAGING_STATS
+        row("Dirty Evictions", 0, [](const ComparisonRun &run) { return run.paging.writeBacks; });
+        const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+        const char *labels[] = {"Fault p50", "Fault p90", "Fault p99", "Fault p99.9"};
+        for (int i = 0; i < 4; i++) {
+            row(labels[i], 0, [&](const ComparisonRun &run) {
+                return histogramPercentile(run.paging.faultLatency, percentiles[i]);
+            });
+        }
+        row("Fault max", 0, [](const ComparisonRun &run) { return run.paging.faultLatency.maxValue; });
+#endif
+    }
+    cout << "(Throughput is references served per 1000 time units; EAT is the effective access time";
+    if (options.compareWith == "flusher") {
+        cout << ";\n fault latency is in time units from a fault to its page being ready";
+    }
+    cout << ")\n";
+    return true;
 }
 
-// Function to show empty memory map
-void showEmptyMemory() {
-    cout << "\nInitial Memory State (All Free):\n";
-    for (auto &frame : memoryFrames) {
-        cout << "Frame " << frame.frameID << " | Free\n";
-    }
+void printUsage(const char *program) {
+    cout << "Usage:\n";
+    cout << "  " << program << "                               (interactive menu)\n";
+    cout << "  " << program << " encode <trace.csv> <trace.dpt>  (jobID,logicalAddress[,W] per line, -1 = job exits)\n";
+    cout << "  " << program << " info <trace.dpt>\n";
+    cout << "  " << program << " dump <trace.dpt> [--start R] [--count N]\n";
+    cout << "  " << program << " replay <trace.dpt> [--jobs jobs.csv] [--scale K] [--frames N] [--page-size B]\n";
+    cout << "         [--start R] [--count N] [--policy fifo|nru|clean] [--nru-interval N]\n";
+    cout << "         [--scope global|local|pff|ws] [--quota equal|proportional|priority]\n";
+    cout << "         [--pff-upper RATE] [--pff-lower RATE] [--ws-window DELTA] [--ws-sample N] [--ws-out ws.csv]\n";
+    cout << "         [--swap-read T] [--swap-write T] [--swap-bandwidth BYTES_PER_T] [--swap-depth N]\n";
+    cout << "         [--flusher] [--flush-threshold FRACTION] [--flush-batch N] [--flush-interval T]\n";
+    cout << "         [--kswapd] [--wm-low FRACTION] [--wm-high FRACTION]\n";
+    cout << "         [--prefetch none|readahead|stride|markov] [--readahead] [--ra-min PAGES] [--ra-max PAGES]\n";
+    cout << "         [--markov-entries N] [--prepage PAGES] [--prepage-resume] [--startup-window N]\n";
+    cout << "         [--huge-pages PAGES] [--huge-min-pages PAGES] [--tlb ENTRIES] [--tlb-miss-cost T]\n";
+    cout << "         [--compaction] [--migrate-cost T] [--khugepaged] [--khugepaged-interval N] [--khugepaged-scan N]\n";
+    cout << "         [--fork N] [--ksm] [--ksm-interval N] [--ksm-pages N] [--ksm-scan-cost T] [--zero-page]\n";
+    cout << "         [--load-control] [--lc-window N] [--lc-high RATE] [--lc-low RATE]\n";
+    cout << "  " << program << " generate <seq|loop|zipf|phased|chase|stride|mixed> [--out trace.dpt] [--replay]\n";
+    cout << "         [--count N] [--seed S] [--zipf THETA] [--burst N] [--phase N] [--working-set P] [--loop P] [--stride P]\n";
+    cout << "         [--churn N] [--writes FRACTION] [--fork-after N]\n";
+    cout << "         (plus the replay options for jobs and memory)\n";
+    cout << "  " << program << " schedule <pattern> [--quantum Q] [--mpl N] [--count N]\n";
+    cout << "         (plus the generate and replay options)\n";
+    cout << "  " << program << " compare <pattern|trace.dpt> --vs load-control|scope|flusher\n";
+    cout << "         (plus the generate and replay options)\n";
 }
 
-// Function to simulate allocation with delay
-void simulateAllocation(vector<Job> &jobs) {
-    cout << "\nSimulating page allocation...\n";
-    for (auto &job : jobs) {
-        cout << "Allocating Job " << job.jobID << "...\n";
-        assignPageFrames(job);
-        this_thread::sleep_for(chrono::milliseconds(700));
+// Function: runCommandLine
+// Purpose: Batch mode for working with reference traces (no menu)
+int runCommandLine(int argc, char *argv[]) {
+    string command = argv[1];
+#ifdef SIGUSR1
+    signal(SIGUSR1, onStatsSignal); // kill -USR1 <pid> prints the stats mid-run
+#endif
+    if (command == "encode" && argc == 4) {
+        return encodeTraceFromCSV(argv[2], argv[3]) ? 0 : 1;
     }
-    cout << "Allocation complete.\n";
+    if (command == "info" && argc == 3) {
+        return showTraceInfo(argv[2]) ? 0 : 1;
+    }
+    if (command == "dump" && argc >= 3) {
+        SimOptions options;
+        if (!parseSimOptions(argc, argv, 3, options)) {
+            return 1;
+        }
+        return dumpTrace(argv[2], options.startRecord, options.maxRecords) ? 0 : 1;
+    }
+    if (command == "replay" && argc >= 3) {
+        SimOptions options;
+        if (!parseSimOptions(argc, argv, 3, options)) {
+            return 1;
+        }
+        vector<Job> jobs = loadJobsForRun(options);
+        return replayTrace(argv[2], jobs, options) ? 0 : 1;
+    }
+    if (command == "generate" && argc >= 3) {
+        SimOptions options;
+        options.pattern = argv[2];
+        if (!parseSimOptions(argc, argv, 3, options)) {
+            return 1;
+        }
+        vector<Job> jobs = loadJobsForRun(options);
+        generateWorkload(jobs, options);
+        return 0;
+    }
+    if (command == "schedule" && argc >= 3) {
+        SimOptions options;
+        options.pattern = argv[2];
+        if (!parseSimOptions(argc, argv, 3, options)) {
+            return 1;
+        }
+        vector<Job> jobs = loadJobsForRun(options);
+        runSchedulerSweep(jobs, options);
+        return 0;
+    }
+    if (command == "compare" && argc >= 3) {
+        SimOptions options;
+        if (!parseSimOptions(argc, argv, 3, options)) {
+            return 1;
+        }
+        return runComparison(argv[2], options) ? 0 : 1;
+    }
+    printUsage(argv[0]);
+    return 1;
 }
 
 
 
-int main() {
+// paging_benchmark.cpp includes this file and supplies its own main
+#ifndef DEMAND_PAGING_NO_MAIN
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        return runCommandLine(argc, argv);
+    }
+
     srand(time(0)); // seed once
 
     // Initialize the memory frames
@@ -408,7 +4823,8 @@ int main() {
         cout << "1. Simulate Page Allocation (Static)\n";
         cout << "2. View Tables\n";
         cout << "3. Resolve Address (Demand Paging)\n";
-        cout << "4. Exit\n";
+        cout << "4. Terminate Job (Release Frames)\n";
+        cout << "5. Exit\n";
         cout << "Enter choice: ";
         cin >> choice;
 
@@ -430,8 +4846,8 @@ int main() {
             cout << "Enter Job ID: ";
             cin >> jobID;
 
-            auto it = find_if(jobs.begin(), jobs.end(), [jobID](Job &j){ return j.jobID == jobID; });
-            if (it != jobs.end()) {
+            Job *it = findJob(jobs, jobID);
+            if (it != nullptr) {
                 // Show the valid address range for this job
                 cout << "Job " << jobID << " has size " << it->jobSize 
                     << " bytes (valid logical addresses: 0 - " << (it->jobSize - 1) << ")\n";
@@ -444,9 +4860,24 @@ int main() {
                 cout << "Job ID not found.\n";
             }
         }
-    } while (choice != 4);
+        else if (choice == 4) {
+            int jobID;
+            cout << "Enter Job ID to terminate: ";
+            cin >> jobID;
+
+            Job *job = findJob(jobs, jobID);
+            if (job != nullptr) {
+                int released = terminateJob(*job);
+                cout << "Job " << jobID << " terminated. Released " << released << " frame(s); "
+                     << freeFrames.size() << " of " << memoryFrames.size() << " frames now free.\n";
+            } else {
+                cout << "Job ID not found.\n";
+            }
+        }
+    } while (choice != 5);
     cout << "Exiting simulator. Goodbye!\n";
     return 0;
 }
+#endif // DEMAND_PAGING_NO_MAIN
 
 
@@ -20,14 +20,21 @@
 #include <ctime>  
 #include <list>
 #include <unordered_set> // for hash similiar to dict in python 
+#include <unordered_map> // for the page table
 #include <fstream> // For file handling
 #include <sstream> // For string stream to parse file - csv
 #include <iomanip> // For formatting output tables
 #include <algorithm> // For count_if
 #include <thread>   // For sleep in simulate
 #include <chrono>   // For sleep in simulate
+#include <functional> // For greater<> in the completion queue
+#include <climits>  // For INT_MAX
 using namespace std;
 
+// Queueing simulation defaults when jobs.csv has no arrival/run columns
+const int DEFAULT_ARRIVAL_GAP = 2; // time units between arrivals
+const int DEFAULT_RUN_TIME = 10; // time units a job holds memory
+
 
 /*
     Jobs divided into pages of equal size 
@@ -36,6 +43,7 @@ using namespace std;
     - an ID
     - its size
     - we want to track how
+    - arrival, run and admission times for the admission queue
 */
 struct Job {
     int jobID;
@@ -45,6 +53,10 @@ struct Job {
     vector<int> pages; // Store page numbers
     // page -> frame
     unordered_map<int, int> pageTable; // Page number to Frame number mapping
+    int arrivalTime = 0; // Virtual time the job arrives
+    int runTime = DEFAULT_RUN_TIME; // Virtual time it holds memory once admitted
+    int admitTime = -1; // Virtual time it got its frames (-1 = not yet)
+    bool waiting = false; // In the admission queue
 };
 
 /*
@@ -90,6 +102,7 @@ void divideJobIntoPages(Job &job) {
 // Global memory frames
 // Physical memory simulation
 vector<PageFrame> memoryFrames;
+int freeFrameCount = 0; // Kept up to date on every allocate / deallocate
 
 // init mem frames
 /*
@@ -102,16 +115,23 @@ void initFrames(int numFrames, int frameSize) {
     for (int i = 0; i < numFrames; i++) {
         memoryFrames.push_back({i, frameSize, true, -1, -1});
     }
+    freeFrameCount = numFrames;
 }
 
 
 // Function to load job pages into page frames randomly
-void assignPageFrames(Job &job){
+// Returns false if the job could not be loaded
+bool assignPageFrames(Job &job){
+    // a job is loaded all at once, so skip it if it already holds frames
+    if (!job.pageTable.empty()) {
+        cerr << "Job ID " << job.jobID << " is already in memory" << endl;
+        return false;
+    }
+
     // check if memory has enough free frames for this job
-    int freeFrames = count_if(memoryFrames.begin(), memoryFrames.end(), [](PageFrame &f){ return f.isFree; });
-    if (job.pages.size() > freeFrames) {
+    if ((int)job.pages.size() > freeFrameCount) {
         cerr << "Not enough free frames to load Job ID " << job.jobID << endl;
-        return;
+        return false;
     }
 
     for (int page: job.pages) {
@@ -127,7 +147,113 @@ void assignPageFrames(Job &job){
 
         // Mark frame as assigned
         job.pageTable[page] = memoryFrames[frameIndex].frameID;
+        freeFrameCount--;
+    }
+    return true;
+}
+
+// Function to release all of a job's frames when it terminates
+// The page table lists exactly the frames the job holds, so this is O(pages)
+int deallocateJob(Job &job) {
+    int released = 0;
+    for (auto &entry : job.pageTable) {
+        PageFrame &frame = memoryFrames[entry.second];
+        frame.isFree = true;
+        frame.jobID = -1;
+        frame.pageNumber = -1;
+        released++;
+    }
+    job.pageTable.clear();
+    freeFrameCount += released;
+    return released;
+}
+
+/*
+    ADMISSION QUEUE
+    Jobs that do not fit wait here instead of being dropped.
+    Whenever frames are released the queue is drained in the order
+    chosen by the admission policy:
+    - FCFS           : only the oldest waiting job may go next (no overtaking)
+    - Smallest-First : the waiting job with the fewest pages
+    - Best-Fit       : the largest waiting job that fits in the free frames
+*/
+enum AdmissionPolicy { ADMIT_FCFS, ADMIT_SMALLEST_FIRST, ADMIT_BEST_FIT };
+const char *ADMISSION_POLICY_NAMES[] = {"FCFS", "Smallest-First", "Best-Fit"};
+const int ADMISSION_POLICY_COUNT = 3;
+
+AdmissionPolicy admissionPolicy = ADMIT_FCFS;
+vector<int> admissionQueue; // Indexes into the jobs vector, in arrival order
+int virtualTime = 0; // Event clock for the menu-driven simulation
+vector<int> menuArrivalTimes; // When each job arrived on that clock (the CSV arrival times are left alone)
+
+// Function to choose the next waiting job to admit
+// Returns its position in the admission queue, or -1 if none can go now
+int pickAdmission(const vector<Job> &jobs) {
+    if (admissionQueue.empty()) {
+        return -1;
+    }
+    if (admissionPolicy == ADMIT_FCFS) {
+        return (int)jobs[admissionQueue[0]].pages.size() <= freeFrameCount ? 0 : -1;
+    }
+
+    int best = -1;
+    for (int i = 0; i < (int)admissionQueue.size(); i++) {
+        int pages = jobs[admissionQueue[i]].pages.size();
+        if (admissionPolicy == ADMIT_SMALLEST_FIRST) {
+            if (best == -1 || pages < (int)jobs[admissionQueue[best]].pages.size()) {
+                best = i;
+            }
+        } else if (pages <= freeFrameCount && (best == -1 || pages > (int)jobs[admissionQueue[best]].pages.size())) {
+            best = i;
+        }
+    }
+    // Smallest-First waits if even the smallest job does not fit
+    if (best != -1 && (int)jobs[admissionQueue[best]].pages.size() > freeFrameCount) {
+        return -1;
+    }
+    return best;
+}
+
+// Function to admit waiting jobs until the policy says stop
+// (arrivalTimes[i] is when job i arrived, for the wait it reports)
+// Returns the indexes of the jobs admitted
+vector<int> drainAdmissionQueue(vector<Job> &jobs, int time, const vector<int> &arrivalTimes, bool verbose) {
+    vector<int> admitted;
+    int position;
+    while ((position = pickAdmission(jobs)) != -1) {
+        int index = admissionQueue[position];
+        admissionQueue.erase(admissionQueue.begin() + position);
+
+        Job &job = jobs[index];
+        assignPageFrames(job);
+        job.waiting = false;
+        job.admitTime = time;
+        admitted.push_back(index);
+        if (verbose) {
+            cout << "Time " << time << ": Job " << job.jobID << " admitted (" << job.pages.size()
+                 << " frames) after waiting " << time - arrivalTimes[index] << "\n";
+        }
     }
+    return admitted;
+}
+
+// Function to submit an arriving job to the admission queue
+// (the caller drains the queue afterwards). Returns false if the job can never fit in memory
+bool submitJob(vector<Job> &jobs, int index) {
+    Job &job = jobs[index];
+    if (job.waiting || !job.pageTable.empty()) {
+        return true; // Already waiting or in memory
+    }
+    if (job.pages.size() > memoryFrames.size()) {
+        cerr << "Job ID " << job.jobID << " needs " << job.pages.size() << " frames but memory only has "
+             << memoryFrames.size() << "; rejected" << endl;
+        return false;
+    }
+
+    job.waiting = true;
+    job.admitTime = -1;
+    admissionQueue.push_back(index);
+    return true;
 }
 
 // Job list array
@@ -139,6 +265,7 @@ void assignPageFrames(Job &job){
     - Job ID
     - Job Size
     - No. of Pages    
+    - Status (in memory / waiting)
 
     Page Map Table:
     - Page Number
@@ -152,10 +279,11 @@ void assignPageFrames(Job &job){
 */
 void displayTables(const vector<Job> &jobs) {
     cout << "\n--- Job Table ---\n";
-    cout << left << setw(8) << "Job ID" << setw(12) << "Job Size" << setw(14) << "No. of Pages" << setw(24) << "Internal Fragmentation" << "\n";
+    cout << left << setw(8) << "Job ID" << setw(12) << "Job Size" << setw(14) << "No. of Pages" << setw(24) << "Internal Fragmentation" << setw(12) << "Status" << "\n";
     for (const auto &job : jobs) {
+        string status = !job.pageTable.empty() ? "In Memory" : (job.waiting ? "Waiting" : "-");
         cout << left << setw(8) << job.jobID << setw(12) << job.jobSize
-                << setw(14) << job.pages.size() << setw(24) << job.internalFragmentation << "\n";
+                << setw(14) << job.pages.size() << setw(24) << job.internalFragmentation << setw(12) << status << "\n";
     }
 
     cout << "\n--- Page Map Table ---\n";
@@ -201,13 +329,24 @@ vector<Job> importJobsFromFile(string filename, int pagesize) {
         string token;
         Job job;
 
-        // CSV format: jobID, jobSize
+        // CSV format: jobID, jobSize [, arrivalTime, runTime]
         getline(ss, token, ',');
+        if (token.empty()) {
+            continue; // Skip blank lines
+        }
         job.jobID = stoi(token);
         getline(ss, token, ',');
         job.jobSize = stoi(token);
         job.pageSize = pagesize;
 
+        job.arrivalTime = jobs.size() * DEFAULT_ARRIVAL_GAP;
+        if (getline(ss, token, ',') && !token.empty()) {
+            job.arrivalTime = stoi(token);
+        }
+        if (getline(ss, token, ',') && !token.empty()) {
+            job.runTime = stoi(token);
+        }
+
         divideJobIntoPages(job);
         jobs.push_back(job);
     }
@@ -222,7 +361,7 @@ void resolveAddress(Job &job, int logicalAddress) {
     int pageNumber = logicalAddress / job.pageSize;
     int offset = logicalAddress % job.pageSize;
 
-    if (pageNumber >= job.pages.size()) {
+    if (pageNumber >= (int)job.pages.size()) {
         cout << "Logical address out of bounds for Job ID " << job.jobID << endl;
         return;
     }
@@ -270,36 +409,197 @@ void showEmptyMemory() {
 
 
 // Function to simulate allocation with delay
+// Jobs that do not fit wait in the admission queue until frames are released
 void simulateAllocation(vector<Job> &jobs) {
-    cout << "\n--- Event-Driven Simulation of Page Allocation ---\n";
-    int timeUnit = 0;
+    cout << "\n--- Event-Driven Simulation of Page Allocation (" << ADMISSION_POLICY_NAMES[admissionPolicy] << ") ---\n";
+    menuArrivalTimes.resize(jobs.size(), 0);
 
-    for (auto &job : jobs) {
+    for (int i = 0; i < (int)jobs.size(); i++) {
+        Job &job = jobs[i];
         // simulate job arrival as an event
-        cout << "Time " << timeUnit << ": Job " << job.jobID << " arrives.\n";
+        cout << "Time " << virtualTime << ": Job " << job.jobID << " arrives.\n";
+        menuArrivalTimes[i] = virtualTime;
         this_thread::sleep_for(chrono::milliseconds(800));
 
         // simulate allocation of this job
-        cout << "Time " << (timeUnit+1) << ": Allocating Job " << job.jobID << " into memory...\n";
-        assignPageFrames(job);
+        cout << "Time " << (virtualTime+1) << ": Allocating Job " << job.jobID << " into memory...\n";
+        if (submitJob(jobs, i)) {
+            drainAdmissionQueue(jobs, virtualTime + 1, menuArrivalTimes, true);
+            if (job.waiting) {
+                cout << "Time " << (virtualTime+1) << ": Job " << job.jobID << " waits (needs " << job.pages.size()
+                     << " frames, " << freeFrameCount << " free, " << admissionQueue.size() << " in queue)\n";
+            }
+        }
         this_thread::sleep_for(chrono::milliseconds(1000));
 
         // display updated tables after allocation
         displayTables(jobs);
 
         // increment the event clock
-        timeUnit += 2;
+        virtualTime += 2;
+    }
+
+    cout << "\nSimulation finished at time " << virtualTime << "\n";
+    if (!admissionQueue.empty()) {
+        cout << admissionQueue.size() << " job(s) waiting; deallocate a job to admit them.\n";
+    }
+}
+
+/*
+    QUEUEING SIMULATION (virtual time, no delays)
+    Jobs arrive at arrivalTime, wait until the admission policy lets them
+    in, hold their frames for runTime, then release them (which drains the
+    queue). Reports each job's wait and memory utilization over time.
+*/
+struct QueueingResult {
+    double averageWait = 0;
+    int maxWait = 0;
+    double utilization = 0; // time-averaged fraction of frames in use
+    int makespan = 0; // time the last job finished
+    int rejected = 0; // jobs larger than memory
+};
+
+// Runs on a copy of the jobs; the caller saves and restores memory
+QueueingResult runQueueingSimulation(vector<Job> jobs, int numFrames, int frameSize, bool verbose) {
+    initFrames(numFrames, frameSize);
+    admissionQueue.clear();
+    for (auto &job : jobs) {
+        job.pageTable.clear();
+        job.waiting = false;
+        job.admitTime = -1;
+    }
+
+    vector<int> arrivalTimes(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) arrivalTimes[i] = jobs[i].arrivalTime;
+    vector<int> arrivals(jobs.size());
+    for (int i = 0; i < (int)jobs.size(); i++) arrivals[i] = i;
+    stable_sort(arrivals.begin(), arrivals.end(), [&jobs](int a, int b) { return jobs[a].arrivalTime < jobs[b].arrivalTime; });
+
+    // (finish time, job index), earliest first
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> completions;
+    QueueingResult result;
+    size_t nextArrival = 0;
+    int time = 0;
+    double busyFrameTime = 0;
+
+    if (verbose) {
+        cout << "\n" << left << setw(8) << "Time" << setw(14) << "Used Frames" << setw(14) << "Util %" << setw(12) << "Queue" << "\n";
+    }
+    while (nextArrival < arrivals.size() || !completions.empty()) {
+        int nextTime = INT_MAX;
+        if (nextArrival < arrivals.size()) nextTime = jobs[arrivals[nextArrival]].arrivalTime;
+        if (!completions.empty()) nextTime = min(nextTime, completions.top().first);
+
+        int usedFrames = numFrames - freeFrameCount;
+        busyFrameTime += (double)usedFrames * (nextTime - time);
+        time = nextTime;
+
+        // Completions first, so an arrival at the same time sees the freed frames
+        while (!completions.empty() && completions.top().first == time) {
+            Job &job = jobs[completions.top().second];
+            completions.pop();
+            deallocateJob(job);
+            if (verbose) cout << "Time " << time << ": Job " << job.jobID << " finishes\n";
+        }
+        while (nextArrival < arrivals.size() && jobs[arrivals[nextArrival]].arrivalTime == time) {
+            int index = arrivals[nextArrival++];
+            if (verbose) cout << "Time " << time << ": Job " << jobs[index].jobID << " arrives\n";
+            if (!submitJob(jobs, index)) {
+                result.rejected++;
+            }
+        }
+        for (int index : drainAdmissionQueue(jobs, time, arrivalTimes, verbose)) {
+            completions.push({time + jobs[index].runTime, index});
+        }
+
+        if (verbose) {
+            int used = numFrames - freeFrameCount;
+            cout << left << setw(8) << time << setw(14) << used << setw(14) << (used * 100 / numFrames) << setw(12) << admissionQueue.size() << "\n";
+        }
     }
+    result.makespan = time;
+    admissionQueue.clear();
 
-    cout << "\nSimulation finished at time " << timeUnit << "\n";
+    int admittedJobs = 0;
+    long long totalWait = 0;
+    if (verbose) {
+        cout << "\n" << left << setw(8) << "Job ID" << setw(8) << "Pages" << setw(10) << "Arrival" << setw(10) << "Admitted" << setw(8) << "Wait" << "\n";
+    }
+    for (const auto &job : jobs) {
+        if (job.admitTime == -1) {
+            continue;
+        }
+        int wait = job.admitTime - job.arrivalTime;
+        totalWait += wait;
+        result.maxWait = max(result.maxWait, wait);
+        admittedJobs++;
+        if (verbose) {
+            cout << left << setw(8) << job.jobID << setw(8) << job.pages.size() << setw(10) << job.arrivalTime
+                 << setw(10) << job.admitTime << setw(8) << wait << "\n";
+        }
+    }
+    if (admittedJobs > 0) result.averageWait = (double)totalWait / admittedJobs;
+    if (time > 0) result.utilization = busyFrameTime / ((double)numFrames * time);
+    return result;
+}
+
+void printQueueingResult(const QueueingResult &result) {
+    cout << "\nAverage Wait : " << fixed << setprecision(2) << result.averageWait << "\n";
+    cout << "Max Wait     : " << result.maxWait << "\n";
+    cout << "Utilization  : " << result.utilization * 100 << "%\n";
+    cout << "Makespan     : " << result.makespan << "\n";
+    if (result.rejected > 0) {
+        cout << "Rejected     : " << result.rejected << " (larger than memory)\n";
+    }
+    cout.unsetf(ios::fixed);
+}
+
+// Function to find the smallest memory meeting a target average wait
+// Tries every frame count up to maxFrames under each admission policy
+void sizeMemoryForTargetWait(const vector<Job> &jobs, int frameSize, double targetWait, int maxFrames) {
+    AdmissionPolicy savedPolicy = admissionPolicy;
+    int smallest[ADMISSION_POLICY_COUNT] = {-1, -1, -1};
+
+    int minFrames = 1;
+    for (const auto &job : jobs) {
+        minFrames = max(minFrames, (int)job.pages.size());
+    }
+
+    cout << "\n" << left << setw(8) << "Frames";
+    for (int p = 0; p < ADMISSION_POLICY_COUNT; p++) {
+        cout << setw(26) << (string(ADMISSION_POLICY_NAMES[p]) + " wait/util%");
+    }
+    cout << "\n";
+    for (int frames = minFrames; frames <= maxFrames; frames++) {
+        cout << left << setw(8) << frames;
+        for (int p = 0; p < ADMISSION_POLICY_COUNT; p++) {
+            admissionPolicy = (AdmissionPolicy)p;
+            QueueingResult result = runQueueingSimulation(jobs, frames, frameSize, false);
+            stringstream cell;
+            cell << fixed << setprecision(2) << result.averageWait << " / " << setprecision(0) << result.utilization * 100;
+            cout << setw(26) << cell.str();
+            if (smallest[p] == -1 && result.averageWait <= targetWait) {
+                smallest[p] = frames;
+            }
+        }
+        cout << "\n";
+    }
+    admissionPolicy = savedPolicy;
+
+    cout << "\nSmallest memory with average wait <= " << targetWait << ":\n";
+    for (int p = 0; p < ADMISSION_POLICY_COUNT; p++) {
+        cout << "  " << left << setw(16) << ADMISSION_POLICY_NAMES[p];
+        if (smallest[p] == -1) cout << "not reached up to " << maxFrames << " frames\n";
+        else cout << smallest[p] << " frames\n";
+    }
 }
 
 
 // Function to show memory stats
 void showMemoryStats() {
     int totalFrames = memoryFrames.size();
-    int usedFrames = count_if(memoryFrames.begin(), memoryFrames.end(), [](PageFrame &f){ return !f.isFree; });
-    int freeFrames = totalFrames - usedFrames;
+    int freeFrames = freeFrameCount;
+    int usedFrames = totalFrames - freeFrames;
 
     cout << "\n--- Memory Stats ---\n";
     cout << "Total Frames: " << totalFrames << "\n";
@@ -336,7 +636,10 @@ int main() {
         cout << "1. Simulate Page Allocation\n";
         cout << "2. View Tables\n";
         cout << "3. Resolve Address\n";
-        cout << "4. Exit\n";
+        cout << "4. Deallocate Job\n";
+        cout << "5. Set Admission Policy\n";
+        cout << "6. Queueing Simulation (Virtual Time)\n";
+        cout << "7. Exit\n";
         cout << "Enter choice: ";
         cin >> choice;
 
@@ -373,7 +676,65 @@ int main() {
                 cout << "Job ID not found.\n";
             }
         }
-    } while (choice != 4);
+        else if (choice == 4) {
+            int jobID;
+            cout << "Enter Job ID to deallocate: ";
+            cin >> jobID;
+
+            auto it = find_if(jobs.begin(), jobs.end(), [jobID](Job &j){ return j.jobID == jobID; });
+            if (it != jobs.end()) {
+                int released = deallocateJob(*it);
+                virtualTime++;
+                cout << "Job " << jobID << " deallocated. Released " << released << " frame(s).\n";
+                // Released frames go to the waiting jobs first
+                drainAdmissionQueue(jobs, virtualTime, menuArrivalTimes, true);
+                showMemoryStats();
+            } else {
+                cout << "Job ID not found.\n";
+            }
+        }
+        else if (choice == 5) {
+            cout << "\nAdmission policy (current: " << ADMISSION_POLICY_NAMES[admissionPolicy] << ")\n";
+            for (int i = 0; i < ADMISSION_POLICY_COUNT; i++) {
+                cout << i + 1 << ". " << ADMISSION_POLICY_NAMES[i] << "\n";
+            }
+            int policy;
+            cout << "Enter choice: ";
+            cin >> policy;
+            if (policy >= 1 && policy <= ADMISSION_POLICY_COUNT) {
+                admissionPolicy = (AdmissionPolicy)(policy - 1);
+                cout << "Admission policy set to " << ADMISSION_POLICY_NAMES[admissionPolicy] << "\n";
+            } else {
+                cout << "Invalid policy.\n";
+            }
+        }
+        else if (choice == 6) {
+            // Run on a copy; the interactive memory state is put back afterwards
+            vector<PageFrame> savedFrames = memoryFrames;
+            int savedFreeCount = freeFrameCount;
+            vector<int> savedQueue = admissionQueue;
+            int frameSize = memoryFrames.empty() ? 512 : memoryFrames[0].frameSize;
+
+            cout << "\n--- Queueing Simulation (" << ADMISSION_POLICY_NAMES[admissionPolicy] << ", "
+                 << savedFrames.size() << " frames) ---\n";
+            QueueingResult result = runQueueingSimulation(jobs, savedFrames.size(), frameSize, true);
+            printQueueingResult(result);
+
+            double target;
+            cout << "\nTarget average wait for memory sizing (-1 to skip): ";
+            cin >> target;
+            if (target >= 0) {
+                int maxFrames;
+                cout << "Largest memory to try (frames): ";
+                cin >> maxFrames;
+                sizeMemoryForTargetWait(jobs, frameSize, target, maxFrames);
+            }
+
+            memoryFrames = savedFrames;
+            freeFrameCount = savedFreeCount;
+            admissionQueue = savedQueue;
+        }
+    } while (choice != 7);
     cout << "Exiting simulator. Goodbye!\n";
     return 0;
 }
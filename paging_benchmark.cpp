@@ -0,0 +1,231 @@
+/* PAGING HOT PATH MICROBENCHMARKS
+    •  Times the demand paging engine functions on their own
+    •  Memory sizes from 10 to 10M frames
+    •  Results are written as JSON so runs can be compared
+
+    // 1. Build a memory of N frames and enough jobs to cover 2N pages
+    // 2. Fill memory to the occupancy being measured
+    // 3. Repeat the operation until it has run for --min-time-ms
+    // 4. Record nanoseconds per operation
+*/
+
+#define DEMAND_PAGING_NO_MAIN
+#include "demand_paging_sim.cpp" // The engine under test (its main is compiled out)
+
+const int BENCH_PAGE_SIZE = 512;
+const int BENCH_PAGES_PER_JOB = 64; // every benchmark job is 64 pages (32 KB)
+
+/*
+    Benchmark result
+    - name of the function measured
+    - size: frames in memory (or rows in the CSV for importJobsFromFile)
+    - occupancy: fraction of frames in use when measured
+*/
+struct BenchResult {
+    string name;
+    string sizeUnit;
+    long long size;
+    double occupancy;
+    uint64_t iterations;
+    double nsPerOp;
+};
+
+vector<BenchResult> results;
+double minSeconds = 0.1; // minimum measured time per benchmark
+
+// Discards everything written to it, so printing functions can be timed without a terminal
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+// Function: runBenchmark
+// Purpose: Runs op in growing batches until one batch takes at least minSeconds
+template <typename Op>
+void runBenchmark(const string &name, const string &sizeUnit, long long size, double occupancy, Op op) {
+    uint64_t iterations = 1;
+    double seconds = 0;
+    while (true) {
+        auto start = chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            op();
+        }
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (seconds >= minSeconds) {
+            break;
+        }
+        // Aim a little past minSeconds next time, but never more than 100x
+        double scale = seconds > 0 ? min(100.0, 1.2 * minSeconds / seconds) : 100.0;
+        iterations = max(iterations * 2, (uint64_t)(iterations * scale));
+    }
+
+    BenchResult result = {name, sizeUnit, size, occupancy, iterations, seconds * 1e9 / iterations};
+    results.push_back(result);
+    cerr << left << setw(20) << name << setw(10) << size << fixed << setprecision(2) << setw(8) << occupancy
+         << setprecision(1) << result.nsPerOp << " ns/op\n";
+    cerr.unsetf(ios::fixed);
+}
+
+// Function: buildScenario
+// Purpose: Creates numFrames frames and 2 * numFrames pages of jobs, then makes
+//          the first occupancy * numFrames frames resident in page order
+vector<Job> buildScenario(int numFrames, double occupancy) {
+    initFrames(numFrames, BENCH_PAGE_SIZE);
+
+    vector<Job> jobs;
+    long long totalPages = 2LL * numFrames;
+    int numJobs = (int)((totalPages + BENCH_PAGES_PER_JOB - 1) / BENCH_PAGES_PER_JOB);
+    jobs.reserve(numJobs);
+    for (int i = 0; i < numJobs; i++) {
+        Job job;
+        job.jobID = i + 1;
+        job.jobSize = BENCH_PAGES_PER_JOB * BENCH_PAGE_SIZE;
+        job.pageSize = BENCH_PAGE_SIZE;
+        divideJobIntoPages(job);
+        jobs.push_back(job);
+    }
+    buildJobIndex(jobs);
+
+    int filled = (int)(occupancy * numFrames);
+    for (int f = 0; f < filled; f++) {
+        currentTime++;
+        mapPageToFrame(jobs[f / BENCH_PAGES_PER_JOB], f % BENCH_PAGES_PER_JOB, f);
+    }
+    return jobs;
+}
+
+// Random resident pages (as global page indexes) for the hit benchmarks
+vector<int> residentSample(int numFrames) {
+    vector<int> sample(1 << 16);
+    for (auto &page : sample) {
+        page = rand() % numFrames;
+    }
+    return sample;
+}
+
+void benchFullMemory(int numFrames) {
+    vector<Job> jobs = buildScenario(numFrames, 1.0);
+    vector<int> sample = residentSample(numFrames);
+    size_t next = 0;
+
+    runBenchmark("loadPage_hit", "frames", numFrames, 1.0, [&] {
+        int page = sample[next++ & 0xffff];
+        loadPage(jobs[page / BENCH_PAGES_PER_JOB], page % BENCH_PAGES_PER_JOB, jobs);
+    });
+
+    NullBuffer nullBuffer;
+    streambuf *console = cout.rdbuf(&nullBuffer);
+    runBenchmark("resolveAddress", "frames", numFrames, 1.0, [&] {
+        int page = sample[next++ & 0xffff];
+        int offset = page & (BENCH_PAGE_SIZE - 1);
+        resolveAddress(jobs[page / BENCH_PAGES_PER_JOB], (page % BENCH_PAGES_PER_JOB) * BENCH_PAGE_SIZE + offset, jobs);
+    });
+    cout.rdbuf(console);
+
+    // Take the oldest frame and link it back in so the order stays full
+    runBenchmark("fifoReplacement", "frames", numFrames, 1.0, [&] {
+        linkReplacement(fifoReplacement());
+    });
+
+    // Cycling through 2N pages with N frames under FIFO misses every time
+    long long totalPages = (long long)jobs.size() * BENCH_PAGES_PER_JOB;
+    long long cursor = numFrames;
+    runBenchmark("loadPage_miss", "frames", numFrames, 1.0, [&] {
+        loadPage(jobs[cursor / BENCH_PAGES_PER_JOB], cursor % BENCH_PAGES_PER_JOB, jobs);
+        if (++cursor == totalPages) cursor = 0;
+    });
+}
+
+void benchOccupancy(int numFrames, double occupancy) {
+    vector<Job> jobs = buildScenario(numFrames, occupancy);
+
+    volatile int sink = 0;
+    runBenchmark("findFreeFrame", "frames", numFrames, occupancy, [&] {
+        sink = findFreeFrame();
+    });
+    (void)sink;
+
+    // An 8-page job (fewer if memory is nearly full), released after every call
+    int freeFrames = numFrames - (int)(occupancy * numFrames);
+    if (freeFrames == 0) {
+        return;
+    }
+    Job job;
+    job.jobID = 0;
+    job.jobSize = min(8, freeFrames) * BENCH_PAGE_SIZE;
+    job.pageSize = BENCH_PAGE_SIZE;
+    divideJobIntoPages(job);
+
+    runBenchmark("assignPageFrames", "frames", numFrames, occupancy, [&] {
+        assignPageFrames(job);
+        terminateJob(job);
+    });
+}
+
+void benchImport(int rows) {
+    string filename = "bench_jobs.csv";
+    ofstream file(filename);
+    for (int i = 1; i <= rows; i++) {
+        file << i << "," << (100 + (i * 7919) % 5000) << "\n";
+    }
+    file.close();
+
+    runBenchmark("importJobsFromFile", "rows", rows, 0.0, [&] {
+        vector<Job> jobs = importJobsFromFile(filename, BENCH_PAGE_SIZE);
+    });
+    remove(filename.c_str());
+}
+
+void writeResults(ostream &out) {
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"" << r.sizeUnit << "\": " << r.size
+            << ", \"occupancy\": " << r.occupancy << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << fixed << setprecision(2) << r.nsPerOp << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+        out.unsetf(ios::fixed);
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+    long long minFrames = 10, maxFrames = 10000000;
+    string outFile;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string name = argv[i];
+        string value = argv[i + 1];
+        if (name == "--min-frames") minFrames = stoll(value);
+        else if (name == "--max-frames") maxFrames = stoll(value);
+        else if (name == "--min-time-ms") minSeconds = stod(value) / 1000.0;
+        else if (name == "--out") outFile = value;
+        else {
+            cerr << "Unknown option: " << name << endl;
+            return 1;
+        }
+    }
+    if (argc % 2 == 0) {
+        cerr << "Usage: " << argv[0] << " [--min-frames N] [--max-frames N] [--min-time-ms T] [--out results.json]\n";
+        return 1;
+    }
+
+    srand(12345); // fixed seed so runs are comparable
+
+    // Frame counts go up by 10x: 10, 100, ..., 10M
+    for (long long frames = minFrames; frames <= maxFrames && frames <= INT_MAX; frames *= 10) {
+        benchFullMemory((int)frames);
+        for (double occupancy : {0.0, 0.5, 0.9, 0.99}) {
+            benchOccupancy((int)frames, occupancy);
+        }
+        benchImport((int)min(frames, 1000000LL));
+    }
+
+    if (outFile.empty()) {
+        writeResults(cout);
+    } else {
+        ofstream out(outFile);
+        writeResults(out);
+        cerr << "Results written to " << outFile << "\n";
+    }
+    return 0;
+}